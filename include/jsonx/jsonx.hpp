@@ -30,6 +30,7 @@
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <functional>
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -37,6 +38,70 @@
 #include <locale>
 #include <codecvt>
 #include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <deque>
+#include <initializer_list>
+#include <unordered_set>
+#include <limits>
+#include <type_traits>
+
+#ifndef JSONX_NO_SIMD
+#   if defined(__AVX2__)
+#       define JSONX_SIMD_AVX2
+#   endif
+#   if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#       define JSONX_SIMD_SSE2
+#   endif
+#endif
+
+#if defined(JSONX_SIMD_AVX2)
+#   include <immintrin.h>
+#elif defined(JSONX_SIMD_SSE2)
+#   include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#endif
+
+#if defined(__has_include)
+#   if __has_include(<charconv>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#       include <charconv>
+#   endif
+#   if __has_include(<optional>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#       include <optional>
+#   endif
+#   if __has_include(<memory_resource>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#       include <memory_resource>
+#   endif
+#endif
+#if defined(__cpp_lib_optional)
+#   define JSONX_HAS_OPTIONAL
+#endif
+#if defined(__cpp_lib_memory_resource)
+#   define JSONX_HAS_MEMORY_RESOURCE
+#endif
+#if defined(__cpp_lib_to_chars)
+#   define JSONX_HAS_CHARCONV
+#else
+#   include <cerrno>
+#   include <clocale>
+#   include <cstdio>
+#endif
+
+#if defined(_WIN32)
+#   include <Windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
 
 #ifndef NOTHING
 #define NOTHING
@@ -81,8 +146,11 @@ namespace Utils {
     {
         if (caseInsensitive)
         {
-            c1 = std::tolower(c1);
-            c2 = std::tolower(c2);
+            // ASCII only, UTF-8 lead/trail bytes are left alone
+            if (c1 >= 'A' && c1 <= 'Z')
+                c1 = static_cast<T>(c1 + ('a' - 'A'));
+            if (c2 >= 'A' && c2 <= 'Z')
+                c2 = static_cast<T>(c2 + ('a' - 'A'));
         }
         return (c1 == c2) ? 0 : (c1 < c2 ? -1 : 1);
     }
@@ -96,19 +164,38 @@ namespace Utils {
         return result;
     }
 
+    template<typename T>
+    int compare(const T* s1, size_t n1, const T* s2, size_t n2, bool caseInsensitive)
+    {
+        const size_t n = (n1 < n2) ? n1 : n2;
+        int result = 0;
+        for (size_t i = 0; 0 == result && i < n; ++i)
+            result = compare<T>(s1[i], s2[i], caseInsensitive);
+        if (0 == result && n1 != n2)
+            result = (n1 < n2) ? -1 : 1;
+        return result;
+    }
+
     template<typename T>
     bool equal(const T* s1, const T* s2, bool caseInsensitive)
     {
         return (0 == compare<T>(s1, s2, caseInsensitive));
     }
 
+    template<typename T>
+    bool equal(const T* s1, size_t n1, const T* s2, size_t n2, bool caseInsensitive)
+    {
+        return (n1 == n2) && (0 == compare<T>(s1, n1, s2, n2, caseInsensitive));
+    }
+
     // JSON escape/unescape rules:
     //  https://tools.ietf.org/html/rfc7159#page-8
-    FORCEDINLINE std::string escape(const std::string& s)
+    FORCEDINLINE std::string escape(const char* s, size_t n)
     {
         std::string s2;
-        const char* pos = s.c_str();
-        while(*pos)
+        const char* pos = s;
+        const char* end = s + n;
+        while(pos < end)
         {
             switch(*pos)
             {
@@ -145,86 +232,258 @@ namespace Utils {
         return std::move(s2);
     }
 
+    FORCEDINLINE std::string escape(const std::string& s)
+    {
+        return escape(s.data(), s.size());
+    }
+
+    // Same rules, appended to sink (anything with append(const char*, size_t))
+    // in runs of the bytes which need no escape
+    template<typename Sink>
+    void escape(const char* s, size_t n, Sink& sink)
+    {
+        const char* run = s;
+        const char* end = s + n;
+        for (const char* pos = s; pos < end; ++pos)
+        {
+            const char* e = nullptr;
+            switch (*pos)
+            {
+            case '\"':
+                e = "\\\"";
+                break;
+            case '\\':
+                e = "\\\\";
+                break;
+            case '/':
+                e = "\\/";
+                break;
+            case '\b':
+                e = "\\b";
+                break;
+            case '\f':
+                e = "\\f";
+                break;
+            case '\n':
+                e = "\\n";
+                break;
+            case '\r':
+                e = "\\r";
+                break;
+            case '\t':
+                e = "\\t";
+                break;
+            default:
+                continue;
+            }
+            if (pos != run)
+                sink.append(run, static_cast<size_t>(pos - run));
+            sink.append(e, 2);
+            run = pos + 1;
+        }
+        if (end != run)
+            sink.append(run, static_cast<size_t>(end - run));
+    }
+
+    // Write code point cp as UTF-8 into u (4 bytes at most), returns the length
+    inline size_t encodeUtf8(uint32_t cp, char* u)
+    {
+        if (cp < 0x80)
+        {
+            u[0] = static_cast<char>(cp);
+            return 1;
+        }
+        if (cp < 0x800)
+        {
+            u[0] = static_cast<char>(0xC0 | (cp >> 6));
+            u[1] = static_cast<char>(0x80 | (cp & 0x3F));
+            return 2;
+        }
+        if (cp < 0x10000)
+        {
+            u[0] = static_cast<char>(0xE0 | (cp >> 12));
+            u[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            u[2] = static_cast<char>(0x80 | (cp & 0x3F));
+            return 3;
+        }
+        u[0] = static_cast<char>(0xF0 | (cp >> 18));
+        u[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        u[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        u[3] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 4;
+    }
+
+    inline bool readHex4(const char* pos, uint32_t& v)
+    {
+        v = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            const char c = pos[i];
+            v <<= 4;
+            if (c >= '0' && c <= '9')
+                v |= static_cast<uint32_t>(c - '0');
+            else if (c >= 'a' && c <= 'f')
+                v |= static_cast<uint32_t>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F')
+                v |= static_cast<uint32_t>(c - 'A' + 10);
+            else
+                return false;
+        }
+        return true;
+    }
+
+    // Decode one escape sequence, pos points to the character right after the
+    // backslash. The decoded UTF-8 (4 bytes at most, never longer than the
+    // sequence itself) is written to u and its length to n. Returns the position
+    // after the sequence, or nullptr if the sequence is invalid or truncated.
+    inline const char* decodeEscape(const char* pos, const char* end, char* u, size_t& n)
+    {
+        if (pos >= end)
+            return nullptr;
+        n = 1;
+        switch (*pos)
+        {
+        case '\"': u[0] = '\"'; return pos + 1;
+        case '\\': u[0] = '\\'; return pos + 1;
+        case '/': u[0] = '/'; return pos + 1;
+        case 'b': u[0] = '\b'; return pos + 1;
+        case 'f': u[0] = '\f'; return pos + 1;
+        case 'n': u[0] = '\n'; return pos + 1;
+        case 'r': u[0] = '\r'; return pos + 1;
+        case 't': u[0] = '\t'; return pos + 1;
+        case 'u':
+            break;
+        default:
+            return nullptr;
+        }
+
+        // \uXXXX, characters outside the BMP are written as a surrogate pair
+        uint32_t cp = 0;
+        if (end - pos < 5 || !readHex4(pos + 1, cp))
+            return nullptr;
+        pos += 5;
+        if (cp >= 0xD800 && cp <= 0xDBFF)
+        {
+            uint32_t lo = 0;
+            if (end - pos < 6 || pos[0] != '\\' || pos[1] != 'u' || !readHex4(pos + 2, lo) || lo < 0xDC00 || lo > 0xDFFF)
+                return nullptr;
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+            pos += 6;
+        }
+        else if (cp >= 0xDC00 && cp <= 0xDFFF)
+        {
+            return nullptr;
+        }
+        n = encodeUtf8(cp, u);
+        return pos;
+    }
+
+    // Same as decodeEscape(), appending the decoded character to s
+    inline const char* unescapeChar(const char* pos, const char* end, std::string& s)
+    {
+        char u[4];
+        size_t n = 0;
+        const char* next = decodeEscape(pos, end, u, n);
+        if (nullptr != next)
+            s.append(u, n);
+        return next;
+    }
+
     FORCEDINLINE std::string unescape(const std::string& s)
     {
         std::string s2;
         const char* pos = s.c_str();
-        while(*pos)
+        const char* end = pos + s.size();
+        while (pos < end)
         {
-            if(*pos == '\\')
+            const char* esc = static_cast<const char*>(memchr(pos, '\\', static_cast<size_t>(end - pos)));
+            if (nullptr == esc)
             {
-                // escaped character
-                ++pos;
-                if (*pos == '\"')
-                {
-                    s2.append("\"");
-                    ++pos;
-                }
-                else if(*pos == '\\')
-                {
-                    s2.append("\\");
-                    ++pos;
-                }
-                else if (*pos == '/')
-                {
-                    s2.append("/");
-                    ++pos;
-                }
-                else if (*pos == 'b')
-                {
-                    s2.append("\b");
-                    ++pos;
-                }
-                else if (*pos == 'f')
-                {
-                    s2.append("\f");
-                    ++pos;
-                }
-                else if (*pos == 'n')
-                {
-                    s2.append("\n");
-                    ++pos;
-                }
-                else if (*pos == 'r')
-                {
-                    s2.append("\r");
-                    ++pos;
-                }
-                else if (*pos == 't')
-                {
-                    s2.append("\t");
-                    ++pos;
-                }
-                else if (*pos == 'u')
-                {
-                    ++pos;
-                    // Next four digits must be hex
-                    if(std::isxdigit((int)pos[0]) && std::isxdigit((int)pos[1]) && std::isxdigit((int)pos[2]) && std::isxdigit((int)pos[3]))
-                    {
-                        std::string sHex(pos, 4);
-                        const wchar_t wc = (wchar_t)std::strtoul(sHex.c_str(), nullptr, 16);
-                        s2.append(toUtf8(std::wstring(&wc, 1)));
-                        pos += 4;
-                    }
-                    else
-                    {
-                        // Error happened
-                        break;
-                    }
-                }
-                else
-                {
-                    s2.append(pos, 1);
-                    ++pos;
-                }
+                s2.append(pos, end);
+                break;
             }
-            else
+            s2.append(pos, esc);
+            pos = esc + 1;
+            // escaped character
+            const char* next = unescapeChar(pos, end, s2);
+            if (nullptr != next)
+            {
+                pos = next;
+            }
+            else if (pos < end && *pos != 'u')
             {
+                // Unknown escape, keep the character
                 s2.append(pos, 1);
                 ++pos;
             }
+            else
+            {
+                // Error happened
+                break;
+            }
         }
-        return std::move(s2);
+        return s2;
+    }
+
+    // Check that s is well-formed UTF-8: no overlong forms, surrogates or code
+    // points above U+10FFFF. ASCII runs are passed over 16 bytes at a time.
+    inline bool validUtf8(const char* s, size_t n)
+    {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(s);
+        const unsigned char* end = p + n;
+        while (p < end)
+        {
+#if defined(JSONX_SIMD_SSE2)
+            while (end - p >= 16 && 0 == _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))))
+                p += 16;
+            if (p == end)
+                break;
+#endif
+            const unsigned char c = *p;
+            if (c < 0x80)
+            {
+                ++p;
+                continue;
+            }
+
+            size_t len = 0;
+            unsigned char lo = 0x80;
+            unsigned char hi = 0xBF;
+            if (c >= 0xC2 && c <= 0xDF)
+            {
+                len = 2;
+            }
+            else if (c >= 0xE0 && c <= 0xEF)
+            {
+                len = 3;
+                if (c == 0xE0)
+                    lo = 0xA0;
+                else if (c == 0xED)
+                    hi = 0x9F;
+            }
+            else if (c >= 0xF0 && c <= 0xF4)
+            {
+                len = 4;
+                if (c == 0xF0)
+                    lo = 0x90;
+                else if (c == 0xF4)
+                    hi = 0x8F;
+            }
+            else
+            {
+                return false;
+            }
+
+            if (static_cast<size_t>(end - p) < len || p[1] < lo || p[1] > hi)
+                return false;
+            for (size_t i = 2; i < len; ++i)
+            {
+                if ((p[i] & 0xC0) != 0x80)
+                    return false;
+            }
+            p += len;
+        }
+        return true;
     }
 }
 
@@ -244,9 +503,48 @@ typedef enum JsonError {
     JEMismatchValueType,
     JEUnexpectedChar,
     JEUnexpectedEnd,
-    JEMissingColon
+    JEMissingColon,
+    JENumberOutOfRange,
+    JEAborted,
+    JEInvalidUtf8,
+    JEMaxDepthExceeded,
+    JEDuplicateKey
 } JsonError;
 
+// Value type of a column of a columnar array
+typedef enum ColumnType {
+    ColumnInt64 = 0,
+    ColumnDecimal,
+    ColumnBoolean,
+    ColumnString
+} ColumnType;
+
+// Which member is kept when an object has the same key more than once
+typedef enum DuplicateKeyPolicy {
+    DuplicateLastWins = 0,
+    DuplicateFirstWins,
+    DuplicateError
+} DuplicateKeyPolicy;
+
+typedef enum TokenType {
+    TokenNone = 0,
+    TokenNull,
+    TokenBoolean,
+    TokenNumber,
+    TokenString,
+    TokenKey,
+    TokenStartObject,
+    TokenEndObject,
+    TokenStartArray,
+    TokenEndArray
+} TokenType;
+
+typedef enum FeedStatus {
+    NeedMoreData = 0,
+    ValueComplete,
+    FeedError
+} FeedStatus;
+
 class SerializeConfig
 {
 public:
@@ -297,1266 +595,7028 @@ private:
     size_t indentSize;
 };
 
-namespace IMPLEMENT {
+class StringPool;
 
-class ValueBase
+class ParseConfig
 {
 public:
-    virtual ~ValueBase() {}
+    ParseConfig()
+        : structuralIndex(false), fileMapping(true), populate(false), threads(1), lazy(false), maxDepth(DefaultMaxDepth), duplicateKeys(DuplicateLastWins)
+        , stringPool(nullptr), internLength(0), columnar(false), rawNumbers(false), arena(false)
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        , resource(nullptr)
+#endif
+    {
+    }
 
-    virtual bool isNull() const { return false; }
-    virtual bool isBoolean() const { return false; }
-    virtual bool isNumber() const { return false; }
-    virtual bool isString() const { return false; }
-    virtual bool isObject() const { return false; }
-    virtual bool isArray() const { return false; }
+    enum { DefaultMaxDepth = 1024 };
+    ~ParseConfig()
+    {
+    }
 
-    virtual std::string serialize(SerializeConfig* config) const = 0;
-    virtual size_t size() const = 0;
+    // Run a vectorized structural indexing pass before parsing. It pays off on
+    // large documents, small inputs are parsed faster without it.
+    inline bool useStructuralIndex() const { return structuralIndex; }
+    inline void setStructuralIndex(bool v) { structuralIndex = v; }
+
+    // Value::parseFile() maps the file and parses it in situ, the document
+    // keeps the mapping. Off: the file is read into memory and released.
+    inline bool useFileMapping() const { return fileMapping; }
+    inline void setFileMapping(bool v) { fileMapping = v; }
+
+    // Fault the whole mapping in up front (MAP_POPULATE, Linux only)
+    inline bool usePopulate() const { return populate; }
+    inline void setPopulate(bool v) { populate = v; }
+
+    // Parse the elements of a large top-level array on n threads (0: one per
+    // core). 1 turns it off.
+    inline size_t getThreads() const { return threads; }
+    inline void setThreads(size_t n) { threads = n; }
+
+    // Only validate the document; objects and arrays are read when they are
+    // first accessed, and only one level at a time, with a copy of this
+    // config. DuplicateError reads the whole document at once.
+    inline bool useLazy() const { return lazy; }
+    inline void setLazy(bool v) { lazy = v; }
+
+    // Deepest nesting of objects/arrays accepted, deeper input fails with
+    // JEMaxDepthExceeded. 0: no limit.
+    inline size_t getMaxDepth() const { return maxDepth; }
+    inline void setMaxDepth(size_t n) { maxDepth = n; }
+
+    // Keys which appear more than once in an object (compared like lookups,
+    // case-insensitive). The member stays where the key first appears.
+    // DuplicateError fails with JEDuplicateKey. Default: DuplicateLastWins.
+    inline DuplicateKeyPolicy getDuplicateKeys() const { return duplicateKeys; }
+    inline void setDuplicateKeys(DuplicateKeyPolicy v) { duplicateKeys = v; }
+
+    // Object keys, and string values of at most maxValueLength bytes, are
+    // taken from pool: equal strings share one buffer across all documents.
+    // The pool must outlive the documents. Default: none.
+    inline StringPool* getStringPool() const { return stringPool; }
+    inline size_t getInternLength() const { return internLength; }
+    inline void setStringPool(StringPool* pool, size_t maxValueLength = 0)
+    {
+        stringPool = pool;
+        internLength = maxValueLength;
+    }
 
-protected:
-    ValueBase() {}
+    // Arrays of objects with the same keys and scalar values of one type per
+    // key are stored as one column per key (see Value::getColumns()). Const
+    // element access builds a row when it is read, non-const access and
+    // non-const iterators convert the array back. Default: off.
+    inline bool useColumnar() const { return columnar; }
+    inline void setColumnar(bool v) { columnar = v; }
+
+    // Numbers keep their source text: they are converted on first access and
+    // serialized exactly as they were read. Rows with such numbers are not
+    // stored in columns. Default: off.
+    inline bool useRawNumbers() const { return rawNumbers; }
+    inline void setRawNumbers(bool v) { rawNumbers = v; }
+
+    // Each document gets an arena: its nodes, their reference counts, the
+    // vectors of its containers and its strings are allocated from large
+    // blocks which are released at once. DOM parsing only. Default: off.
+    inline bool useArena() const { return arena; }
+    inline void setArena(bool v) { arena = v; }
+
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    // Documents are allocated from an arena whose blocks, and the arena
+    // itself, come from resource, like what is added to them after the
+    // parse. resource must outlive the documents, and be thread-safe with
+    // setThreads(). Implies setArena(true). Default: none.
+    inline std::pmr::memory_resource* getMemoryResource() const { return resource; }
+    inline void setMemoryResource(std::pmr::memory_resource* r) { resource = r; }
+#endif
+
+private:
+    bool structuralIndex;
+    bool fileMapping;
+    bool populate;
+    size_t threads;
+    bool lazy;
+    size_t maxDepth;
+    DuplicateKeyPolicy duplicateKeys;
+    StringPool* stringPool;
+    size_t internLength;
+    bool columnar;
+    bool rawNumbers;
+    bool arena;
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    std::pmr::memory_resource* resource;
+#endif
 };
 
-class ValueNull : public ValueBase
+// Events of the SAX interface (JSONX::parse() with a handler). A handler is a
+// template parameter, it doesn't need to derive from this class but it is an
+// easy way to only implement some of the events. Returning false stops the
+// parser with JEAborted. String views are not null-terminated.
+class BaseHandler
 {
 public:
-    virtual ~ValueNull() {}
-    virtual bool isNull() const { return true; }
-    virtual std::string serialize(SerializeConfig* config) const { return "null"; }
-    virtual size_t size() const { return 0; }
-
-    static ValueNull* create() { return new ValueNull(); }
-
-private:
-    ValueNull() {}
+    inline bool null() { return true; }
+    inline bool boolean(bool v) { (void)v; return true; }
+    inline bool int64(int64_t v) { (void)v; return true; }
+    inline bool uint64(uint64_t v) { (void)v; return true; }
+    inline bool decimal(double v) { (void)v; return true; }
+    inline bool string(const char* s, size_t n) { (void)s; (void)n; return true; }
+    inline bool startObject() { return true; }
+    inline bool key(const char* s, size_t n) { (void)s; (void)n; return true; }
+    inline bool endObject(size_t count) { (void)count; return true; }
+    inline bool startArray() { return true; }
+    inline bool endArray(size_t count) { (void)count; return true; }
 };
 
-class ValueBoolean : public ValueBase
+// Table of immutable strings shared across objects and documents, for keys
+// and short string values which repeat (see ParseConfig::setStringPool()).
+// Thread-safe; the table is split into shards with their own lock so that
+// parser threads seldom wait for each other. Strings stay until the pool is
+// destroyed, so equal strings always get the same pointer.
+class StringPool
 {
 public:
-    virtual ~ValueBoolean() {}
-    virtual bool isBoolean() const { return true; }
-    virtual size_t size() const { return 1; }
-    virtual std::string serialize(SerializeConfig* config) const { return val ? "true" : "false"; }
+    StringPool() : count(0) {}
+    ~StringPool() {}
 
-    static ValueBoolean* create(bool v) { return new ValueBoolean(v); }
+    // Pooled, null-terminated copy of s[0, n)
+    const char* intern(const char* s, size_t n)
+    {
+        const uint64_t h = hash(s, n);
+        Shard& shard = shards[static_cast<size_t>((h * 0x9E3779B97F4A7C15ULL) >> 60)];
+        std::lock_guard<std::mutex> lock(shard.lock);
+        const Entry probe(s, n, h);
+        const auto it = shard.index.find(probe);
+        if (it != shard.index.end())
+            return it->s;
+
+        // Deque elements never move, neither do their characters
+        shard.strings.push_back(std::string(s, n));
+        const char* p = shard.strings.back().data();
+        shard.index.insert(Entry(p, n, h));
+        ++count;
+        return p;
+    }
 
-    operator bool() const { return val; }
-    inline bool get() const { return val; }
-    inline void set(bool v) { val = v; }
+    const char* intern(const std::string& s)
+    {
+        return intern(s.data(), s.size());
+    }
+
+    // Number of distinct strings
+    inline size_t size() const { return count; }
 
 private:
-    explicit ValueBoolean(bool v)
-        : ValueBase()
-        , val(v)
+    StringPool(const StringPool&);
+    StringPool& operator = (const StringPool&);
+
+    struct Entry
+    {
+        Entry(const char* p, size_t len, uint64_t hv) : s(p), n(len), h(hv) {}
+        const char* s;
+        size_t n;
+        uint64_t h;
+    };
+
+    struct EntryHash
+    {
+        size_t operator()(const Entry& e) const { return static_cast<size_t>(e.h); }
+    };
+
+    struct EntryEqual
+    {
+        bool operator()(const Entry& a, const Entry& b) const
+        {
+            return a.n == b.n && 0 == memcmp(a.s, b.s, a.n);
+        }
+    };
+
+    struct Shard
     {
+        std::mutex lock;
+        std::deque<std::string> strings;
+        std::unordered_set<Entry, EntryHash, EntryEqual> index;
+    };
+
+    // FNV-1a
+    static inline uint64_t hash(const char* s, size_t n)
+    {
+        uint64_t h = 0xCBF29CE484222325ULL;
+        for (size_t i = 0; i < n; ++i)
+        {
+            h ^= static_cast<unsigned char>(s[i]);
+            h *= 0x100000001B3ULL;
+        }
+        return h;
     }
 
-    bool val;
+    Shard shards[16];
+    std::atomic<size_t> count;
 };
 
-class ValueNumber : public ValueBase
+// Paths to keep when parsing (see Value::parse()), everything else is skipped
+// without being built. A path is a JSON Pointer ("/user/id") or dotted
+// ("user.id"); "*" matches any member or element. Keys are matched exactly.
+class Projection
 {
 public:
-    virtual ~ValueNumber() {}
-    virtual bool isNumber() const { return true; }
-    virtual std::string serialize(SerializeConfig* config) const { return valDecimal ? std::to_string(d) : std::to_string(n); }
-    virtual size_t size() const { return 1; }
+    // One node per path segment
+    class Node
+    {
+    public:
+        Node() : whole(false) {}
 
-    static ValueNumber* create(int32_t v) { return new ValueNumber(v); }
-    static ValueNumber* create(int64_t v) { return new ValueNumber(v); }
-    static ValueNumber* create(uint32_t v) { return new ValueNumber(v); }
-    static ValueNumber* create(uint64_t v) { return new ValueNumber(v); }
-    static ValueNumber* create(float v) { return new ValueNumber(v); }
-    static ValueNumber* create(double v) { return new ValueNumber(v); }
+        // Selected child of a member key or element index, nullptr if none
+        const Node* find(const char* key, size_t n) const
+        {
+            for (const auto& child : children)
+            {
+                if (child.first.size() == n && 0 == memcmp(child.first.data(), key, n))
+                    return child.second.get();
+            }
+            return any.get();
+        }
 
-    inline bool isSigned() const { return valSigned; }
-    inline bool isDecimal() const { return valDecimal; }
-    inline bool isInteger() const { return !valDecimal; }
+        inline bool isWhole() const { return whole; }
+        inline bool hasNamed() const { return !children.empty(); }
 
-    inline int32_t toInt32() const { return valDecimal ? static_cast<int32_t>(d) : static_cast<int32_t>(n); }
-    inline int64_t toInt64() const { return valDecimal ? static_cast<int64_t>(d) : n; }
-    inline uint32_t toUint32() const { return valDecimal ? static_cast<uint32_t>(d) : static_cast<uint32_t>(u); }
-    inline uint64_t toUint64() const { return valDecimal ? static_cast<uint64_t>(d) : u; }
-    inline double toDecimal() const { return valDecimal ? d : (n*1.0); }
+    private:
+        friend class Projection;
+        Node(const Node&);
+        Node& operator = (const Node&);
 
-    inline void set(int32_t v) { n = v; valSigned = (v < 0); valDecimal = false; }
-    inline void set(int64_t v) { n = v; valSigned = (v < 0); valDecimal = false; }
-    inline void set(uint32_t v) { u = v; valSigned = false; valDecimal = false; }
-    inline void set(uint64_t v) { u = v; valSigned = false; valDecimal = false; }
-    inline void set(float_t v) { d = v; valSigned = (v < 0); valDecimal = true; }
-    inline void set(double_t v) { d = v; valSigned = (v < 0); valDecimal = true; }
+        std::unique_ptr<Node> clone() const
+        {
+            std::unique_ptr<Node> p(new Node());
+            p->whole = whole;
+            for (const auto& child : children)
+                p->children.push_back(std::make_pair(child.first, child.second->clone()));
+            if (any)
+                p->any = any->clone();
+            return p;
+        }
 
-private:
-    explicit ValueNumber(int32_t v)
-        : ValueBase()
-        , n(v)
-        , valSigned(v < 0)
-        , valDecimal(false)
-    {
-    }
-    explicit ValueNumber(int64_t v)
-        : ValueBase()
-        , n(v)
-        , valSigned(v < 0)
-        , valDecimal(false)
+        // The path ends here: the whole value is kept
+        bool whole;
+        std::vector<std::pair<std::string, std::unique_ptr<Node>>> children;
+        // Child of "*"
+        std::unique_ptr<Node> any;
+    };
+
+    Projection() {}
+    Projection(std::initializer_list<std::string> paths)
     {
+        for (const auto& path : paths)
+            add(path);
     }
-    explicit ValueNumber(uint32_t v)
-        : ValueBase()
-        , u(v)
-        , valSigned(false)
-        , valDecimal(false)
+    explicit Projection(const std::vector<std::string>& paths)
     {
+        for (const auto& path : paths)
+            add(path);
     }
-    explicit ValueNumber(uint64_t v)
-        : ValueBase()
-        , u(v)
-        , valSigned(false)
-        , valDecimal(false)
+    ~Projection() {}
+
+    void add(const std::string& path)
     {
+        std::vector<std::string> segments;
+        if (!path.empty() && path[0] == '/')
+        {
+            size_t start = 1;
+            do {
+                size_t end = path.find('/', start);
+                if (end == std::string::npos)
+                    end = path.size();
+                segments.push_back(unescape(path.substr(start, end - start)));
+                start = end + 1;
+            } while (start <= path.size());
+        }
+        else if (!path.empty())
+        {
+            size_t start = 0;
+            do {
+                size_t end = path.find('.', start);
+                if (end == std::string::npos)
+                    end = path.size();
+                segments.push_back(path.substr(start, end - start));
+                start = end + 1;
+            } while (start <= path.size());
+        }
+        add(root, segments, 0);
     }
-    explicit ValueNumber(float v)
-        : ValueBase()
-        , d(v)
-        , valSigned(v < 0)
-        , valDecimal(true)
+
+    inline const Node& getRoot() const { return root; }
+
+private:
+    Projection(const Projection&);
+    Projection& operator = (const Projection&);
+
+    // "~1" is '/' and "~0" is '~'
+    static std::string unescape(const std::string& s)
     {
+        std::string r;
+        for (size_t i = 0; i < s.size(); ++i)
+        {
+            if (s[i] == '~' && i + 1 < s.size() && (s[i + 1] == '0' || s[i + 1] == '1'))
+                r.push_back(s[++i] == '0' ? '~' : '/');
+            else
+                r.push_back(s[i]);
+        }
+        return r;
     }
-    explicit ValueNumber(double v)
-        : ValueBase()
-        , d(v)
-        , valSigned(v < 0)
-        , valDecimal(true)
+
+    // A named child also gets what "*" selects at the same level, so that
+    // lookups only need to follow one node
+    static void add(Node& node, const std::vector<std::string>& segments, size_t i)
     {
+        if (i == segments.size())
+        {
+            node.whole = true;
+            return;
+        }
+
+        if (segments[i] == "*")
+        {
+            if (!node.any)
+                node.any.reset(new Node());
+            add(*node.any, segments, i + 1);
+            for (auto& child : node.children)
+                add(*child.second, segments, i + 1);
+            return;
+        }
+
+        Node* child = nullptr;
+        for (auto& c : node.children)
+        {
+            if (c.first == segments[i])
+            {
+                child = c.second.get();
+                break;
+            }
+        }
+        if (nullptr == child)
+        {
+            std::unique_ptr<Node> p(node.any ? node.any->clone() : std::unique_ptr<Node>(new Node()));
+            child = p.get();
+            node.children.push_back(std::make_pair(segments[i], std::move(p)));
+        }
+        add(*child, segments, i + 1);
     }
 
-    bool valSigned;
-    bool valDecimal;
-    union {
-        int64_t n;
-        uint64_t u;
-        double_t d;
-    };
+private:
+    Node root;
 };
 
-class ValueString : public ValueBase
+namespace IMPLEMENT {
+
+// Character data of a string value or an object key. It either owns its bytes,
+// or refers to a range inside a buffer that the document keeps alive (in-situ
+// parsing). A borrowed range is not null-terminated.
+class StringData
 {
 public:
-    virtual ~ValueString() {}
-    virtual bool isString() const { return true; }
-    virtual std::string serialize(SerializeConfig* config) const
+    StringData() : ref(nullptr), refSize(0) {}
+    StringData(const std::string& s) : own(s), ref(nullptr), refSize(0) {}
+    StringData(std::string&& s) : own(std::move(s)), ref(nullptr), refSize(0) {}
+    StringData(const char* s) : own(s), ref(nullptr), refSize(0) {}
+    StringData(const StringData& rhs) : own(rhs.own), ref(rhs.ref), refSize(rhs.refSize) {}
+    StringData(StringData&& rhs) : own(std::move(rhs.own)), ref(rhs.ref), refSize(rhs.refSize) {}
+    ~StringData() {}
+
+    StringData& operator = (const StringData& rhs)
     {
-        std::string s("\"");
-        s.append(Utils::escape(val));
-        s.append("\"");
-        return s;
+        if (this != &rhs)
+        {
+            own = rhs.own;
+            ref = rhs.ref;
+            refSize = rhs.refSize;
+        }
+        return *this;
     }
-    virtual size_t size() const { return 1; }
-
-    static ValueString* create(const std::string& s, bool escaped) { return new ValueString(s, escaped); }
-    static ValueString* create(const std::wstring& s, bool escaped) { return new ValueString(s, escaped); }
 
-    inline bool empty() const { return val.empty(); }
-    inline void clear() { val.clear(); }
-    inline const std::string& get() const { return val; }
-    inline std::wstring getw() const { return Utils::toUtf16(val); }
-
-    void set(const std::string& s, bool escaped)
+    StringData& operator = (StringData&& rhs)
     {
-        val = escaped ? s : Utils::escape(s);
+        if (this != &rhs)
+        {
+            own = std::move(rhs.own);
+            ref = rhs.ref;
+            refSize = rhs.refSize;
+        }
+        return *this;
     }
-    void set(const std::wstring& s, bool escaped)
+
+    static StringData borrow(const char* s, size_t n)
     {
-        val = escaped ? Utils::toUtf8(s) : Utils::escape(Utils::toUtf8(s));
+        StringData sd;
+        sd.ref = s;
+        sd.refSize = n;
+        return sd;
     }
 
-private:
-    explicit ValueString(const std::string& s, bool escaped)
-        : val(escaped ? Utils::unescape(s) : s)
+    inline bool borrowed() const { return (nullptr != ref); }
+    inline const char* data() const { return ref ? ref : own.data(); }
+    inline size_t size() const { return ref ? refSize : own.size(); }
+    inline bool empty() const { return (0 == size()); }
+    inline std::string str() const { return ref ? std::string(ref, refSize) : own; }
+    inline void clear()
     {
+        own.clear();
+        ref = nullptr;
+        refSize = 0;
     }
 
-    explicit ValueString(const std::wstring& s, bool escaped)
-        : val(escaped ? Utils::unescape(Utils::toUtf8(s)) : Utils::toUtf8(s))
+private:
+    std::string own;
+    const char* ref;
+    size_t refSize;
+};
+
+class Arena;
+
+// Source text of a container which is not read yet (lazy parsing), owner
+// keeps it alive. config is the ParseConfig of the document, shared by all
+// its lazy containers. The first access reads the members under mutex, so
+// concurrent const reads of one document are safe. With an arena, the
+// members are read into nodes, which the keys are borrowed from.
+struct LazySource
+{
+    LazySource(const char* s, size_t n, std::shared_ptr<void> o, std::shared_ptr<const ParseConfig> c)
+        : text(s), size(n), owner(o), config(c), loaded(false)
     {
     }
 
-    std::string val;
+    const char* text;
+    size_t size;
+    std::shared_ptr<void> owner;
+    std::shared_ptr<const ParseConfig> config;
+    std::shared_ptr<Arena> nodes;
+    std::mutex mutex;
+    std::atomic<bool> loaded;
 };
 
-class ValueObject : public ValueBase
+// Bump allocator for the nodes and strings of one document (see
+// ParseConfig::setArena()). Nothing is freed before the whole arena is.
+// Not thread-safe: it is only filled by the parser which created it.
+class Arena
 {
 public:
-    virtual ~ValueObject() {}
-    virtual bool isObject() const { return true; }
-    virtual std::string serialize(SerializeConfig* config) const
+    // block: size of the first block
+    explicit Arena(size_t block = 0x10000) : head(nullptr), used(0), capacity(0), total(0), first(block)
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        , upstream(nullptr)
+#endif
     {
-        std::string s("{");
-        if (config && config->isWellFormatted())
+    }
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    // The blocks come from upstream (see ParseConfig::setMemoryResource())
+    explicit Arena(std::pmr::memory_resource* upstream, size_t block = 0x10000) : head(nullptr), used(0), capacity(0), total(0), first(block), upstream(upstream) {}
+#endif
+    ~Arena()
+    {
+        for (size_t i = 0; i < blocks.size(); ++i)
         {
-            config->indentInc();
-            s.append(config->getLineEnding());
-        }
-        bool firstItem = true;
-        std::for_each(begin(), end(), [&](const value_type& item) {
-            if (firstItem)
-            {
-                firstItem = false;
-            }
-            else
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+            if (upstream)
             {
-                s.append(",");
-                if (config && config->isWellFormatted())
-                    s.append(config->getLineEnding());
+                upstream->deallocate(blocks[i], sizes[i], 16);
+                continue;
             }
+#endif
+            delete[] blocks[i];
+        }
+    }
 
-            // Add indent
-            if (config && config->isWellFormatted() && config->getIndentSize() != 0)
-                s.append(config->getIndent().data(), config->getIndent().data() + config->getIndentSize());
-
-            // Key
-            s.append("\"");
-            s.append(Utils::escape(item.first));
-            s.append("\":");
-            if (config && config->isWellFormatted())
-                s.append(" ");
-            // Value
-            s.append(item.second->serialize(config));
-        });
-        if (config && config->isWellFormatted())
+    // 16-byte aligned, strings are packed between the nodes
+    void* allocate(size_t n)
+    {
+        size_t start = (used + 15) & ~static_cast<size_t>(15);
+        if (start + n > capacity)
         {
-            config->indentDec();
-            s.append(config->getLineEnding());
-            if (config->getIndentSize() != 0)
-                s.append(config->getIndent().data(), config->getIndent().data() + config->getIndentSize());
+            grow(n);
+            start = 0;
         }
-        s.append("}");
-        return s;
+        used = start + n;
+        return head + start;
     }
-    virtual size_t size() const { return vals.size(); }
 
-    static ValueObject* create(bool ko = true) { return new ValueObject(ko); }
+    // Copy of s, not null-terminated
+    const char* copy(const char* s, size_t n)
+    {
+        if (used + n > capacity)
+            grow(n);
+        char* p = head + used;
+        memcpy(p, s, n);
+        used += n;
+        return p;
+    }
 
-    typedef std::pair<std::string, std::shared_ptr<ValueBase>> value_type;
-    typedef std::vector<value_type>::iterator iterator;
-    typedef std::vector<value_type>::const_iterator const_iterator;
+    // Blocks are sorted by address
+    bool owns(const void* p) const
+    {
+        const char* c = static_cast<const char*>(p);
+        const auto it = std::upper_bound(blocks.begin(), blocks.end(), c, std::less<const char*>());
+        if (it == blocks.begin())
+            return false;
+        const size_t i = static_cast<size_t>(it - blocks.begin()) - 1;
+        return c < blocks[i] + sizes[i];
+    }
 
-    inline bool keepInitOrder() const { return keepOrder; }
-    inline bool empty() const { return vals.empty(); }
-    inline void clear() { vals.clear(); }
-    inline iterator begin() { return vals.begin(); }
-    inline const_iterator begin() const { return vals.begin(); }
-    inline iterator end() { return vals.end(); }
-    inline const_iterator end() const { return vals.end(); }
+    // Bytes taken from the heap
+    inline size_t capacityBytes() const { return total; }
 
-    std::shared_ptr<ValueBase> get(const std::wstring& key) const
+    static std::shared_ptr<Arena> create(size_t block = 0x10000) { return std::make_shared<Arena>(block); }
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    // The arena itself comes from upstream too
+    static std::shared_ptr<Arena> create(std::pmr::memory_resource* upstream, size_t block = 0x10000)
     {
-        return get(Utils::toUtf8(key));
+        if (nullptr == upstream)
+            return create(block);
+        return std::allocate_shared<Arena>(std::pmr::polymorphic_allocator<Arena>(upstream), upstream, block);
     }
 
-    std::shared_ptr<ValueBase> get(const std::string& key) const
+    // Upstream of the current arena: what is allocated for a document after
+    // it is parsed comes from there
+    static std::pmr::memory_resource* currentUpstream()
     {
-        const_iterator pos = find(key);
-        return (pos != vals.end()) ? (*pos).second : std::shared_ptr<ValueBase>(nullptr);
+        Arena* arena = current();
+        return arena ? arena->upstream : nullptr;
     }
+#endif
 
-    std::shared_ptr<ValueBase> set(const std::string& key, std::shared_ptr<ValueBase> sp)
+    // Arena the nodes being parsed on this thread come from, if any
+    static Arena*& current()
     {
-        iterator pos = find(key);
-        if (pos != vals.end())
-        {
-            (*pos).second = sp;
-        }
-        else
-        {
-            if (keepOrder)
-            {
-                vals.push_back(value_type(key, sp));
-            }
-            else
-            {
-                pos = std::lower_bound(vals.begin(), vals.end(), key, [](const value_type& val, const std::string& key)->bool {
-                    return (0 > Utils::compare<char>(val.first.c_str(), key.c_str(), true));
-                });
-                vals.insert(pos, value_type(key, sp));
-            }
-        }
-        return sp;
+        static thread_local Arena* arena = nullptr;
+        return arena;
     }
 
-    std::shared_ptr<ValueBase> set(const std::string& key) { return set(key, std::shared_ptr<ValueBase>(ValueNull::create())); }
-    std::shared_ptr<ValueBase> set(const std::string& key, bool v) { return set(key, std::shared_ptr<ValueBase>(ValueBoolean::create(v))); }
-    std::shared_ptr<ValueBase> set(const std::string& key, int32_t v) { return set(key, std::shared_ptr<ValueBase>(ValueNumber::create(v))); }
-    std::shared_ptr<ValueBase> set(const std::string& key, int64_t v) { return set(key, std::shared_ptr<ValueBase>(ValueNumber::create(v))); }
-    std::shared_ptr<ValueBase> set(const std::string& key, uint32_t v) { return set(key, std::shared_ptr<ValueBase>(ValueNumber::create(v))); }
-    std::shared_ptr<ValueBase> set(const std::string& key, uint64_t v) { return set(key, std::shared_ptr<ValueBase>(ValueNumber::create(v))); }
-    std::shared_ptr<ValueBase> set(const std::string& key, float v) { return set(key, std::shared_ptr<ValueBase>(ValueNumber::create(v))); }
-    std::shared_ptr<ValueBase> set(const std::string& key, double v) { return set(key, std::shared_ptr<ValueBase>(ValueNumber::create(v))); }
-    std::shared_ptr<ValueBase> set(const std::string& key, const std::string& v) { return set(key, std::shared_ptr<ValueBase>(ValueString::create(v, false))); }
-    std::shared_ptr<ValueBase> set(const std::string& key, const std::wstring& v) { return set(key, std::shared_ptr<ValueBase>(ValueString::create(v, false))); }
+    // Makes arena current for the lifetime of the scope
+    class Scope
+    {
+    public:
+        explicit Scope(Arena* arena) : prev(current()) { current() = arena; }
+        ~Scope() { current() = prev; }
+
+    private:
+        Scope(const Scope&);
+        Scope& operator = (const Scope&);
+        Arena* prev;
+    };
 
 private:
-    iterator find(const std::string& key)
+    Arena(const Arena&);
+    Arena& operator = (const Arena&);
+
+    // Blocks double from the first one to 1 MB, larger requests get their own
+    void grow(size_t n)
     {
-        iterator pos = std::find_if(vals.begin(), vals.end(), [&](const value_type& item)->bool {
-            return Utils::equal<char>(item.first.c_str(), key.c_str(), true);
-        });
-        return pos;
+        size_t size = (0 == capacity) ? first : capacity * 2;
+        if (size > 0x100000)
+            size = 0x100000;
+        if (size < n)
+            size = n;
+        // Reserved first, a block is never lost
+        blocks.reserve(blocks.size() + 1);
+        sizes.reserve(sizes.size() + 1);
+        char* block = nullptr;
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        if (upstream)
+            block = static_cast<char*>(upstream->allocate(size, 16));
+#endif
+        if (nullptr == block)
+            block = new char[size];
+        head = block;
+        const size_t i = static_cast<size_t>(std::upper_bound(blocks.begin(), blocks.end(), block, std::less<const char*>()) - blocks.begin());
+        blocks.insert(blocks.begin() + i, block);
+        sizes.insert(sizes.begin() + i, size);
+        used = 0;
+        capacity = size;
+        total += size;
     }
 
-    const_iterator find(const std::string& key) const
+private:
+    std::vector<char*> blocks;
+    std::vector<size_t> sizes;
+    char* head;
+    size_t used;
+    size_t capacity;
+    size_t total;
+    size_t first;
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    std::pmr::memory_resource* upstream;
+#endif
+};
+
+class ValueBase
+{
+public:
+    virtual ~ValueBase() {}
+
+    // Nodes created while an arena is current come from it. Those are
+    // destroyed by ArenaDeleter, the arena check here is for nodes which are
+    // deleted while they are parsed.
+    static void* operator new(size_t n)
     {
-        const_iterator pos = std::find_if(vals.begin(), vals.end(), [&](const value_type& item)->bool {
-            return Utils::equal<char>(item.first.c_str(), key.c_str(), true);
-        });
-        return pos;
+        Arena* arena = Arena::current();
+        return arena ? arena->allocate(n) : ::operator new(n);
+    }
+    static void operator delete(void* p)
+    {
+        Arena* arena = Arena::current();
+        if (nullptr == arena || !arena->owns(p))
+            ::operator delete(p);
     }
 
+    virtual bool isNull() const { return false; }
+    virtual bool isBoolean() const { return false; }
+    virtual bool isNumber() const { return false; }
+    virtual bool isString() const { return false; }
+    virtual bool isObject() const { return false; }
+    virtual bool isArray() const { return false; }
 
-private:
-    explicit ValueObject(bool ko) : keepOrder(ko) {}
+    virtual std::string serialize(SerializeConfig* config) const = 0;
+    virtual size_t size() const = 0;
 
-    bool keepOrder;
-    std::vector<value_type> vals;
+protected:
+    ValueBase() {}
 };
 
-class ValueArray : public ValueBase
+// Control blocks of arena nodes come from the arena too. Every node keeps
+// the arena alive, so a node may outlive its document.
+template<typename T>
+class ArenaAllocator
 {
 public:
-    virtual ~ValueArray() {}
-    virtual bool isArray() const { return true; }
-    virtual std::string serialize(SerializeConfig* config) const
-    {
-        std::string s("[");
-        if (config && config->isWellFormatted())
-        {
-            config->indentInc();
-            s.append(config->getLineEnding());
-        }
-        bool firstItem = true;
-        std::for_each(begin(), end(), [&](const value_type& item) {
-            if (firstItem)
-            {
-                firstItem = false;
-            }
-            else
-            {
-                s.append(",");
-                if (config && config->isWellFormatted())
-                    s.append(config->getLineEnding());
-            }
+    typedef T value_type;
+    template<typename U> struct rebind { typedef ArenaAllocator<U> other; };
 
-            // Add indent
-            if (config && config->isWellFormatted() && config->getIndentSize() != 0)
-                s.append(config->getIndent().data(), config->getIndent().data() + config->getIndentSize());
+    explicit ArenaAllocator(std::shared_ptr<Arena> a) : arena(std::move(a)) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& rhs) : arena(rhs.arena) {}
 
-            // Value
-            s.append(item->serialize(config));
-        });
-        if (config && config->isWellFormatted())
-        {
-            config->indentDec();
-            s.append(config->getLineEnding());
-            if (config->getIndentSize() != 0)
-                s.append(config->getIndent().data(), config->getIndent().data() + config->getIndentSize());
-        }
-        s.append("]");
-        return s;
-    }
-    virtual size_t size() const { return vals.size(); }
+    T* allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T))); }
+    void deallocate(T* p, size_t n) { (void)p; (void)n; }
 
-    static ValueArray* create() { return new ValueArray(); }
+    template<typename U>
+    bool operator == (const ArenaAllocator<U>& rhs) const { return arena == rhs.arena; }
+    template<typename U>
+    bool operator != (const ArenaAllocator<U>& rhs) const { return arena != rhs.arena; }
 
-    typedef std::shared_ptr<ValueBase> value_type;
-    typedef std::vector<value_type>::iterator iterator;
-    typedef std::vector<value_type>::const_iterator const_iterator;
+    std::shared_ptr<Arena> arena;
+};
 
-    inline bool empty() const { return vals.empty(); }
-    inline void clear() { vals.clear(); }
-    inline iterator begin() { return vals.begin(); }
-    inline const_iterator begin() const { return vals.begin(); }
-    inline iterator end() { return vals.end(); }
-    inline const_iterator end() const { return vals.end(); }
+// The memory of an arena node is released with the arena
+struct ArenaDeleter
+{
+    void operator()(ValueBase* p) const { p->~ValueBase(); }
+};
 
-    std::shared_ptr<ValueBase> get(size_t index) const
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+// A node created with a memory_resource goes back to it
+struct ResourceDeleter
+{
+    ResourceDeleter(std::pmr::memory_resource* r, size_t n, size_t a) : resource(r), size(n), align(a) {}
+    void operator()(ValueBase* p) const
     {
-        return (index < vals.size()) ? vals[index] : std::shared_ptr<ValueBase>();
+        p->~ValueBase();
+        resource->deallocate(p, size, align);
     }
 
-    std::shared_ptr<ValueBase> push_back(std::shared_ptr<ValueBase> sp) { vals.push_back(sp); return sp; }
-    std::shared_ptr<ValueBase> push_back(bool v) { return push_back(std::shared_ptr<ValueBase>(ValueBoolean::create(v))); }
-    std::shared_ptr<ValueBase> push_back(int32_t v) { return push_back(std::shared_ptr<ValueBase>(ValueNumber::create(v))); }
-    std::shared_ptr<ValueBase> push_back(int64_t v) { return push_back(std::shared_ptr<ValueBase>(ValueNumber::create(v))); }
-    std::shared_ptr<ValueBase> push_back(uint32_t v) { return push_back(std::shared_ptr<ValueBase>(ValueNumber::create(v))); }
-    std::shared_ptr<ValueBase> push_back(uint64_t v) { return push_back(std::shared_ptr<ValueBase>(ValueNumber::create(v))); }
-    std::shared_ptr<ValueBase> push_back(float v) { return push_back(std::shared_ptr<ValueBase>(ValueNumber::create(v))); }
-    std::shared_ptr<ValueBase> push_back(double v) { return push_back(std::shared_ptr<ValueBase>(ValueNumber::create(v))); }
-    std::shared_ptr<ValueBase> push_back(const std::string& v) { return push_back(std::shared_ptr<ValueBase>(ValueString::create(v, false))); }
-    std::shared_ptr<ValueBase> push_back(const std::wstring& v) { return push_back(std::shared_ptr<ValueBase>(ValueString::create(v, false))); }
-
-private:
-    ValueArray() {}
-    std::vector<std::shared_ptr<ValueBase>> vals;
+    std::pmr::memory_resource* resource;
+    size_t size;
+    size_t align;
+};
+
+// Node T built in place by construct(memory), it and its reference count
+// come from resource (the heap if nullptr)
+template<typename T, typename Construct>
+std::shared_ptr<T> allocateNode(std::pmr::memory_resource* resource, Construct construct)
+{
+    void* m = resource ? resource->allocate(sizeof(T), alignof(T)) : ::operator new(sizeof(T));
+    T* p = nullptr;
+    try
+    {
+        p = construct(m);
+    }
+    catch (...)
+    {
+        if (resource)
+            resource->deallocate(m, sizeof(T), alignof(T));
+        else
+            ::operator delete(m);
+        throw;
+    }
+    if (nullptr == resource)
+        return std::shared_ptr<T>(p);
+    return std::shared_ptr<T>(p, ResourceDeleter(resource, sizeof(T), alignof(T)), std::pmr::polymorphic_allocator<T>(resource));
+}
+#endif
+
+// Allocator of the member vectors of objects and arrays: from the arena which
+// is current when the container is created, as long as it is the current one.
+// Once the document is parsed, containers which grow move to the upstream
+// resource of the arena, or the heap, so the arena is never filled by
+// several threads or without bound. The container's node is in the same
+// arena and keeps it alive.
+template<typename T>
+class ContainerAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+    template<typename U> struct rebind { typedef ContainerAllocator<U> other; };
+
+    ContainerAllocator() : arena(Arena::current())
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        , resource(Arena::currentUpstream())
+#endif
+    {
+    }
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    // Everything from resource (the heap if nullptr)
+    explicit ContainerAllocator(std::pmr::memory_resource* r) : arena(nullptr), resource(r) {}
+#endif
+    template<typename U>
+    ContainerAllocator(const ContainerAllocator<U>& rhs) : arena(rhs.arena)
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        , resource(rhs.resource)
+#endif
+    {
+    }
+
+    // A copy belongs to whoever makes it, or keeps the resource
+    ContainerAllocator select_on_container_copy_construction() const
+    {
+        ContainerAllocator a;
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        if (nullptr == a.arena)
+            a.resource = resource;
+#endif
+        return a;
+    }
+
+    T* allocate(size_t n)
+    {
+        if (nullptr != arena && arena == Arena::current())
+            return static_cast<T*>(arena->allocate(n * sizeof(T)));
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        if (nullptr != resource)
+            return static_cast<T*>(resource->allocate(n * sizeof(T), alignof(T)));
+#endif
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t n)
+    {
+        (void)n;
+        if (nullptr != arena && arena->owns(p))
+            return;
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        if (nullptr != resource)
+        {
+            resource->deallocate(p, n * sizeof(T), alignof(T));
+            return;
+        }
+#endif
+        ::operator delete(p);
+    }
+
+    template<typename U>
+    bool operator == (const ContainerAllocator<U>& rhs) const { return arena == rhs.arena && getResource() == rhs.getResource(); }
+    template<typename U>
+    bool operator != (const ContainerAllocator<U>& rhs) const { return !(*this == rhs); }
+
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    inline std::pmr::memory_resource* getResource() const { return resource; }
+#else
+    inline void* getResource() const { return nullptr; }
+#endif
+
+    Arena* arena;
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    std::pmr::memory_resource* resource;
+#endif
+};
+
+class ValueNull : public ValueBase
+{
+public:
+    virtual ~ValueNull() {}
+    virtual bool isNull() const { return true; }
+    virtual std::string serialize(SerializeConfig* config) const { return "null"; }
+    virtual size_t size() const { return 0; }
+
+    static ValueNull* create() { return new ValueNull(); }
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    static std::shared_ptr<ValueNull> create(std::pmr::memory_resource* r)
+    {
+        return allocateNode<ValueNull>(r, [](void* m) { return ::new (m) ValueNull(); });
+    }
+#endif
+
+private:
+    ValueNull() {}
+};
+
+class ValueBoolean : public ValueBase
+{
+public:
+    virtual ~ValueBoolean() {}
+    virtual bool isBoolean() const { return true; }
+    virtual size_t size() const { return 1; }
+    virtual std::string serialize(SerializeConfig* config) const { return val ? "true" : "false"; }
+
+    static ValueBoolean* create(bool v) { return new ValueBoolean(v); }
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    static std::shared_ptr<ValueBoolean> create(bool v, std::pmr::memory_resource* r)
+    {
+        return allocateNode<ValueBoolean>(r, [&](void* m) { return ::new (m) ValueBoolean(v); });
+    }
+#endif
+
+    operator bool() const { return val; }
+    inline bool get() const { return val; }
+    inline void set(bool v) { val = v; }
+
+private:
+    explicit ValueBoolean(bool v)
+        : ValueBase()
+        , val(v)
+    {
+    }
+
+    bool val;
+};
+
+class ValueNumber : public ValueBase
+{
+public:
+    virtual ~ValueNumber() {}
+    virtual bool isNumber() const { return true; }
+    virtual std::string serialize(SerializeConfig* config) const
+    {
+        // A raw number is written as it was read
+        if (!raw.empty())
+            return raw.str();
+        if (!valDecimal)
+            return valSigned ? std::to_string(n) : std::to_string(u);
+        return formatDecimal(d);
+    }
+    virtual size_t size() const { return 1; }
+
+    static ValueNumber* create(int32_t v) { return new ValueNumber(v); }
+    static ValueNumber* create(int64_t v) { return new ValueNumber(v); }
+    static ValueNumber* create(uint32_t v) { return new ValueNumber(v); }
+    static ValueNumber* create(uint64_t v) { return new ValueNumber(v); }
+    static ValueNumber* create(float v) { return new ValueNumber(v); }
+    static ValueNumber* create(double v) { return new ValueNumber(v); }
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    static std::shared_ptr<ValueNumber> create(int32_t v, std::pmr::memory_resource* r) { return allocateNode<ValueNumber>(r, [&](void* m) { return ::new (m) ValueNumber(v); }); }
+    static std::shared_ptr<ValueNumber> create(int64_t v, std::pmr::memory_resource* r) { return allocateNode<ValueNumber>(r, [&](void* m) { return ::new (m) ValueNumber(v); }); }
+    static std::shared_ptr<ValueNumber> create(uint32_t v, std::pmr::memory_resource* r) { return allocateNode<ValueNumber>(r, [&](void* m) { return ::new (m) ValueNumber(v); }); }
+    static std::shared_ptr<ValueNumber> create(uint64_t v, std::pmr::memory_resource* r) { return allocateNode<ValueNumber>(r, [&](void* m) { return ::new (m) ValueNumber(v); }); }
+    static std::shared_ptr<ValueNumber> create(float v, std::pmr::memory_resource* r) { return allocateNode<ValueNumber>(r, [&](void* m) { return ::new (m) ValueNumber(v); }); }
+    static std::shared_ptr<ValueNumber> create(double v, std::pmr::memory_resource* r) { return allocateNode<ValueNumber>(r, [&](void* m) { return ::new (m) ValueNumber(v); }); }
+#endif
+
+    // Raw number: text is a valid JSON number, kept as is and converted on
+    // first use (see ParseConfig::setRawNumbers())
+    static ValueNumber* createRaw(StringData&& text) { return new ValueNumber(std::move(text)); }
+
+    inline bool isRaw() const { return !raw.empty(); }
+    inline const StringData& text() const { return raw; }
+
+    inline bool isSigned() const { resolve(); return valSigned; }
+    inline bool isDecimal() const { resolve(); return valDecimal; }
+    inline bool isInteger() const { resolve(); return !valDecimal; }
+
+    inline int32_t toInt32() const { resolve(); return valDecimal ? static_cast<int32_t>(d) : static_cast<int32_t>(n); }
+    inline int64_t toInt64() const { resolve(); return valDecimal ? static_cast<int64_t>(d) : n; }
+    inline uint32_t toUint32() const { resolve(); return valDecimal ? static_cast<uint32_t>(d) : static_cast<uint32_t>(u); }
+    inline uint64_t toUint64() const { resolve(); return valDecimal ? static_cast<uint64_t>(d) : u; }
+    inline double toDecimal() const { resolve(); return valDecimal ? d : (valSigned ? static_cast<double>(n) : static_cast<double>(u)); }
+
+    inline void set(int32_t v) { clearRaw(); n = v; valSigned = (v < 0); valDecimal = false; }
+    inline void set(int64_t v) { clearRaw(); n = v; valSigned = (v < 0); valDecimal = false; }
+    inline void set(uint32_t v) { clearRaw(); u = v; valSigned = false; valDecimal = false; }
+    inline void set(uint64_t v) { clearRaw(); u = v; valSigned = false; valDecimal = false; }
+    inline void set(float_t v) { clearRaw(); d = v; valSigned = (v < 0); valDecimal = true; }
+    inline void set(double_t v) { clearRaw(); d = v; valSigned = (v < 0); valDecimal = true; }
+
+    // Shortest text that reads back as exactly the same double
+    static std::string formatDecimal(double v)
+    {
+        char s[32];
+        return std::string(s, formatDecimal(v, s));
+    }
+
+    // Same as above into s (32 bytes), returns the end of the text
+    static char* formatDecimal(double v, char* s)
+    {
+        // Not representable in JSON
+        if (v != v || v - v != 0)
+        {
+            memcpy(s, "null", 4);
+            return s + 4;
+        }
+
+#ifdef JSONX_HAS_CHARCONV
+        char* end = std::to_chars(s, s + 32, v).ptr;
+#else
+        for (int precision = 15; precision <= 17; ++precision)
+        {
+            snprintf(s, 32, "%.*g", precision, v);
+            if (strtod(s, nullptr) == v)
+                break;
+        }
+        // Printed with the C locale's decimal point
+        const char point = localeconv()->decimal_point[0];
+        char* end = s + strlen(s);
+        std::replace(s, end, point, '.');
+#endif
+        // Keep it a decimal number when read back
+        if (std::find_if(s, end, [](char c) { return c == '.' || c == 'e' || c == 'E'; }) == end)
+        {
+            *end++ = '.';
+            *end++ = '0';
+        }
+        return end;
+    }
+
+private:
+    explicit ValueNumber(int32_t v)
+        : ValueBase()
+        , valSigned(v < 0)
+        , valDecimal(false)
+        , n(v)
+        , pending(false)
+    {
+    }
+    explicit ValueNumber(int64_t v)
+        : ValueBase()
+        , valSigned(v < 0)
+        , valDecimal(false)
+        , n(v)
+        , pending(false)
+    {
+    }
+    explicit ValueNumber(uint32_t v)
+        : ValueBase()
+        , valSigned(false)
+        , valDecimal(false)
+        , u(v)
+        , pending(false)
+    {
+    }
+    explicit ValueNumber(uint64_t v)
+        : ValueBase()
+        , valSigned(false)
+        , valDecimal(false)
+        , u(v)
+        , pending(false)
+    {
+    }
+    explicit ValueNumber(float v)
+        : ValueBase()
+        , valSigned(v < 0)
+        , valDecimal(true)
+        , d(v)
+        , pending(false)
+    {
+    }
+    explicit ValueNumber(double v)
+        : ValueBase()
+        , valSigned(v < 0)
+        , valDecimal(true)
+        , d(v)
+        , pending(false)
+    {
+    }
+
+    explicit ValueNumber(StringData&& text)
+        : ValueBase()
+        , valSigned(false)
+        , valDecimal(false)
+        , u(0)
+        , raw(std::move(text))
+        , pending(true)
+    {
+    }
+
+    // Convert the raw text on first use, defined after scanNumber()
+    inline void resolve() const
+    {
+        if (pending)
+            convert();
+    }
+    void convert() const;
+
+    inline void clearRaw()
+    {
+        raw.clear();
+        pending = false;
+    }
+
+    bool valSigned;
+    bool valDecimal;
+    union {
+        int64_t n;
+        uint64_t u;
+        double_t d;
+    };
+    // Source text of a raw number
+    StringData raw;
+    mutable bool pending;
+};
+
+class ValueString : public ValueBase
+{
+public:
+    virtual ~ValueString() { release(); }
+    virtual bool isString() const { return true; }
+    virtual std::string serialize(SerializeConfig* config) const
+    {
+        std::string s("\"");
+        s.append(Utils::escape(val.data(), val.size()));
+        s.append("\"");
+        return s;
+    }
+    virtual size_t size() const { return 1; }
+
+    static ValueString* create(const std::string& s, bool escaped) { return new ValueString(s, escaped); }
+    static ValueString* create(std::string&& s, bool escaped) { return new ValueString(std::move(s), escaped); }
+    static ValueString* create(const std::wstring& s, bool escaped) { return new ValueString(s, escaped); }
+    static ValueString* create(StringData&& s) { return new ValueString(std::move(s)); }
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    // The text comes from r too, also when it is set later
+    static std::shared_ptr<ValueString> create(const std::string& s, bool escaped, std::pmr::memory_resource* r)
+    {
+        std::shared_ptr<ValueString> p = allocateNode<ValueString>(r, [&](void* m) { return ::new (m) ValueString(s, escaped); });
+        p->useResource(r);
+        return p;
+    }
+    static std::shared_ptr<ValueString> create(const std::wstring& s, bool escaped, std::pmr::memory_resource* r)
+    {
+        std::shared_ptr<ValueString> p = allocateNode<ValueString>(r, [&](void* m) { return ::new (m) ValueString(s, escaped); });
+        p->useResource(r);
+        return p;
+    }
+#endif
+
+    inline bool empty() const { return val.empty(); }
+    inline void clear() { release(); val.clear(); }
+    inline std::string get() const { return val.str(); }
+    inline std::wstring getw() const { return Utils::toUtf16(val.str()); }
+    inline const StringData& text() const { return val; }
+
+    void set(const std::string& s, bool escaped)
+    {
+        assign(escaped ? std::string(s) : Utils::escape(s));
+    }
+    void set(const std::wstring& s, bool escaped)
+    {
+        assign(escaped ? Utils::toUtf8(s) : Utils::escape(Utils::toUtf8(s)));
+    }
+
+private:
+    explicit ValueString(const std::string& s, bool escaped)
+        : val(escaped ? Utils::unescape(s) : s)
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        , resource(Arena::currentUpstream()), held(0)
+#endif
+    {
+    }
+
+    explicit ValueString(std::string&& s, bool escaped)
+        : val(escaped ? Utils::unescape(s) : std::move(s))
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        , resource(Arena::currentUpstream()), held(0)
+#endif
+    {
+    }
+
+    explicit ValueString(const std::wstring& s, bool escaped)
+        : val(escaped ? Utils::unescape(Utils::toUtf8(s)) : Utils::toUtf8(s))
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        , resource(Arena::currentUpstream()), held(0)
+#endif
+    {
+    }
+
+    explicit ValueString(StringData&& s)
+        : val(std::move(s))
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        , resource(Arena::currentUpstream()), held(0)
+#endif
+    {
+    }
+
+    ValueString(const ValueString&);
+    ValueString& operator = (const ValueString&);
+
+    // With a resource, the text is copied there and borrowed
+    void assign(std::string&& s)
+    {
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        if (nullptr != resource)
+        {
+            char* p = s.empty() ? nullptr : static_cast<char*>(resource->allocate(s.size(), 1));
+            if (nullptr != p)
+                memcpy(p, s.data(), s.size());
+            release();
+            val = p ? StringData::borrow(p, s.size()) : StringData();
+            held = p ? s.size() : 0;
+            return;
+        }
+#endif
+        val = std::move(s);
+    }
+
+    inline void release()
+    {
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        if (0 != held)
+            resource->deallocate(const_cast<char*>(val.data()), held, 1);
+        held = 0;
+#endif
+    }
+
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    void useResource(std::pmr::memory_resource* r)
+    {
+        resource = r;
+        if (nullptr != r)
+            assign(val.str());
+    }
+#endif
+
+    StringData val;
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    // Text set later comes from resource, held bytes of it are owned by val
+    std::pmr::memory_resource* resource;
+    size_t held;
+#endif
+};
+
+class ValueObject : public ValueBase
+{
+public:
+    virtual ~ValueObject() {}
+    virtual bool isObject() const { return true; }
+    virtual std::string serialize(SerializeConfig* config) const
+    {
+        std::string s("{");
+        if (config && config->isWellFormatted())
+        {
+            config->indentInc();
+            s.append(config->getLineEnding());
+        }
+        bool firstItem = true;
+        std::for_each(begin(), end(), [&](const value_type& item) {
+            if (firstItem)
+            {
+                firstItem = false;
+            }
+            else
+            {
+                s.append(",");
+                if (config && config->isWellFormatted())
+                    s.append(config->getLineEnding());
+            }
+
+            // Add indent
+            if (config && config->isWellFormatted() && config->getIndentSize() != 0)
+                s.append(config->getIndent().data(), config->getIndent().data() + config->getIndentSize());
+
+            // Key
+            s.append("\"");
+            s.append(Utils::escape(item.first.data(), item.first.size()));
+            s.append("\":");
+            if (config && config->isWellFormatted())
+                s.append(" ");
+            // Value
+            s.append(item.second->serialize(config));
+        });
+        if (config && config->isWellFormatted())
+        {
+            config->indentDec();
+            s.append(config->getLineEnding());
+            if (config->getIndentSize() != 0)
+                s.append(config->getIndent().data(), config->getIndent().data() + config->getIndentSize());
+        }
+        s.append("}");
+        return s;
+    }
+    virtual size_t size() const { load(); return vals.size(); }
+
+    typedef std::pair<StringData, std::shared_ptr<ValueBase>> value_type;
+    typedef std::vector<value_type, ContainerAllocator<value_type>> container_type;
+
+    static ValueObject* create(bool ko = true) { return new ValueObject(ko); }
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    // The node, the member vector and the values set() creates come from r.
+    // Keys are still owned strings.
+    static std::shared_ptr<ValueObject> create(bool ko, std::pmr::memory_resource* r)
+    {
+        return allocateNode<ValueObject>(r, [&](void* m) { return ::new (m) ValueObject(ko, container_type::allocator_type(r)); });
+    }
+#endif
+
+    // Lazy object: the members are read from s when first accessed
+    static ValueObject* createLazy(const char* s, size_t n, std::shared_ptr<void> owner, std::shared_ptr<const ParseConfig> config, bool ko = true)
+    {
+        ValueObject* p = new ValueObject(ko);
+        p->source = std::allocate_shared<LazySource>(ContainerAllocator<LazySource>(), s, n, owner, config);
+        return p;
+    }
+
+    typedef container_type::iterator iterator;
+    typedef container_type::const_iterator const_iterator;
+
+    inline bool keepInitOrder() const { return keepOrder; }
+    inline bool isLoaded() const { return (nullptr == source || source->loaded.load(std::memory_order_acquire)); }
+    inline bool empty() const { load(); return vals.empty(); }
+    inline void clear() { source.reset(); vals.clear(); }
+    inline iterator begin() { load(); return vals.begin(); }
+    inline const_iterator begin() const { load(); return vals.begin(); }
+    inline iterator end() { load(); return vals.end(); }
+    inline const_iterator end() const { load(); return vals.end(); }
+
+    std::shared_ptr<ValueBase> get(const std::wstring& key) const
+    {
+        return get(Utils::toUtf8(key));
+    }
+
+    std::shared_ptr<ValueBase> get(const std::string& key) const
+    {
+        const_iterator pos = find(key.data(), key.size());
+        return (pos != vals.end()) ? (*pos).second : std::shared_ptr<ValueBase>(nullptr);
+    }
+
+    std::shared_ptr<ValueBase> set(StringData key, std::shared_ptr<ValueBase> sp)
+    {
+        iterator pos = find(key.data(), key.size());
+        if (pos != vals.end())
+        {
+            (*pos).second = sp;
+        }
+        else
+        {
+            if (keepOrder)
+            {
+                vals.push_back(value_type(std::move(key), sp));
+            }
+            else
+            {
+                pos = std::lower_bound(vals.begin(), vals.end(), key, [](const value_type& val, const StringData& key)->bool {
+                    return (0 > Utils::compare<char>(val.first.data(), val.first.size(), key.data(), key.size(), true));
+                });
+                vals.insert(pos, value_type(std::move(key), sp));
+            }
+        }
+        return sp;
+    }
+
+    // Bulk building: append() adds a member without looking for its key, and
+    // build() resolves the duplicate keys (and sorts the members if the order
+    // isn't kept) once at the end. O(n log n) instead of O(n^2) with set().
+    // build() fails only with DuplicateError, the object is unchanged then.
+    inline void append(StringData key, std::shared_ptr<ValueBase> sp)
+    {
+        load();
+        vals.push_back(value_type(std::move(key), std::move(sp)));
+    }
+
+    bool build(DuplicateKeyPolicy policy = DuplicateLastWins)
+    {
+        load();
+        const size_t n = vals.size();
+        bool dropped = false;
+        if (n <= 16)
+        {
+            // Few members, compare them pairwise
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (size_t j = i + 1; j < n; ++j)
+                {
+                    if (!vals[j].second || !sameKey(vals[i], vals[j]))
+                        continue;
+                    if (DuplicateError == policy)
+                        return false;
+                    if (DuplicateLastWins == policy)
+                        vals[i].second = std::move(vals[j].second);
+                    vals[j].second.reset();
+                    dropped = true;
+                }
+            }
+        }
+        else
+        {
+            // Equal keys are next to each other once sorted, the stable sort
+            // keeps them in their original order
+            std::vector<size_t> order(n);
+            for (size_t i = 0; i < n; ++i)
+                order[i] = i;
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)->bool {
+                return (0 > Utils::compare<char>(vals[a].first.data(), vals[a].first.size(), vals[b].first.data(), vals[b].first.size(), true));
+            });
+            for (size_t i = 0; i < n; )
+            {
+                size_t j = i + 1;
+                while (j < n && sameKey(vals[order[i]], vals[order[j]]))
+                    ++j;
+                if (j - i > 1)
+                {
+                    if (DuplicateError == policy)
+                        return false;
+                    if (DuplicateLastWins == policy)
+                        vals[order[i]].second = std::move(vals[order[j - 1]].second);
+                    for (size_t k = i + 1; k < j; ++k)
+                        vals[order[k]].second.reset();
+                    dropped = true;
+                }
+                i = j;
+            }
+        }
+
+        if (dropped)
+        {
+            vals.erase(std::remove_if(vals.begin(), vals.end(), [](const value_type& item)->bool {
+                return !item.second;
+            }), vals.end());
+        }
+        if (!keepOrder)
+        {
+            std::sort(vals.begin(), vals.end(), [](const value_type& a, const value_type& b)->bool {
+                return (0 > Utils::compare<char>(a.first.data(), a.first.size(), b.first.data(), b.first.size(), true));
+            });
+        }
+        return true;
+    }
+
+    std::shared_ptr<ValueBase> set(const std::string& key) { return set(key, make<ValueNull>()); }
+    std::shared_ptr<ValueBase> set(const std::string& key, bool v) { return set(key, make<ValueBoolean>(v)); }
+    std::shared_ptr<ValueBase> set(const std::string& key, int32_t v) { return set(key, make<ValueNumber>(v)); }
+    std::shared_ptr<ValueBase> set(const std::string& key, int64_t v) { return set(key, make<ValueNumber>(v)); }
+    std::shared_ptr<ValueBase> set(const std::string& key, uint32_t v) { return set(key, make<ValueNumber>(v)); }
+    std::shared_ptr<ValueBase> set(const std::string& key, uint64_t v) { return set(key, make<ValueNumber>(v)); }
+    std::shared_ptr<ValueBase> set(const std::string& key, float v) { return set(key, make<ValueNumber>(v)); }
+    std::shared_ptr<ValueBase> set(const std::string& key, double v) { return set(key, make<ValueNumber>(v)); }
+    std::shared_ptr<ValueBase> set(const std::string& key, const std::string& v) { return set(key, make<ValueString>(v, false)); }
+    std::shared_ptr<ValueBase> set(const std::string& key, const std::wstring& v) { return set(key, make<ValueString>(v, false)); }
+
+private:
+    // A new value for set(), from the resource of the members if any
+    template<typename T, typename... Args>
+    std::shared_ptr<ValueBase> make(Args&&... args) const
+    {
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        if (nullptr != vals.get_allocator().getResource())
+            return T::create(std::forward<Args>(args)..., vals.get_allocator().getResource());
+#endif
+        return std::shared_ptr<ValueBase>(T::create(std::forward<Args>(args)...));
+    }
+
+    static inline bool sameKey(const value_type& a, const value_type& b)
+    {
+        // Pooled keys
+        if (a.first.data() == b.first.data() && a.first.size() == b.first.size())
+            return true;
+        return Utils::equal<char>(a.first.data(), a.first.size(), b.first.data(), b.first.size(), true);
+    }
+
+    iterator find(const char* key, size_t n)
+    {
+        load();
+        iterator pos = std::find_if(vals.begin(), vals.end(), [&](const value_type& item)->bool {
+            return Utils::equal<char>(item.first.data(), item.first.size(), key, n, true);
+        });
+        return pos;
+    }
+
+    const_iterator find(const char* key, size_t n) const
+    {
+        load();
+        const_iterator pos = std::find_if(vals.begin(), vals.end(), [&](const value_type& item)->bool {
+            return Utils::equal<char>(item.first.data(), item.first.size(), key, n, true);
+        });
+        return pos;
+    }
+
+
+    inline void load() const
+    {
+        if (!isLoaded())
+            expand();
+    }
+
+    // Read the members of a lazy object, defined after Parser
+    void expand() const;
+
+private:
+    explicit ValueObject(bool ko) : keepOrder(ko) {}
+    ValueObject(bool ko, const container_type::allocator_type& alloc) : keepOrder(ko), vals(alloc) {}
+
+    bool keepOrder;
+    // Members are read on first access of a lazy object, even a const one
+    mutable container_type vals;
+    // From the arena of the document, like the node
+    mutable std::shared_ptr<LazySource> source;
+};
+
+// Elements of an array which are all objects with the same keys, in the same
+// order, and scalar values of one type per key: one key list and one
+// contiguous column per key instead of an object per element (see
+// ParseConfig::setColumnar()).
+class ColumnTable
+{
+public:
+    typedef std::vector<std::shared_ptr<ValueBase>, ContainerAllocator<std::shared_ptr<ValueBase>>> RowList;
+
+    class Column
+    {
+    public:
+        explicit Column(ColumnType t) : type(t) {}
+
+        inline ColumnType getType() const { return type; }
+        // One value per row, for int64/decimal/boolean columns
+        inline const int64_t* int64s() const { return ints.data(); }
+        inline const double* decimals() const { return decs.data(); }
+        inline const uint8_t* booleans() const { return bools.data(); }
+        // String of a row, not null-terminated
+        inline void getString(size_t row, const char*& s, size_t& n) const
+        {
+            s = chars.data() + offsets[row];
+            n = offsets[row + 1] - offsets[row];
+        }
+
+    private:
+        friend class ColumnTable;
+        ColumnType type;
+        std::vector<int64_t> ints;
+        std::vector<double> decs;
+        std::vector<uint8_t> bools;
+        // Start of each row in chars, plus the end
+        std::vector<size_t> offsets;
+        std::string chars;
+    };
+
+    // Columns for the keys of row, nullptr if row doesn't fit in columns
+    static ColumnTable* create(const ValueObject& row)
+    {
+        if (row.empty())
+            return nullptr;
+        std::unique_ptr<ColumnTable> p(new ColumnTable(row.keepInitOrder()));
+        for (const auto& item : row)
+        {
+            ColumnType type = ColumnInt64;
+            if (!columnType(item.second.get(), type))
+                return nullptr;
+            // Owned: rows are built later and may outlive a borrowed key
+            p->keys.push_back(StringData(item.first.str()));
+            p->cols.push_back(Column(type));
+            if (ColumnString == type)
+                p->cols.back().offsets.push_back(0);
+        }
+        return p.release();
+    }
+
+    // Add row if it has the same keys and value types, else nothing changes
+    bool append(const ValueObject& row)
+    {
+        if (row.size() != keys.size() || row.keepInitOrder() != keepOrder)
+            return false;
+        size_t i = 0;
+        for (const auto& item : row)
+        {
+            ColumnType type = ColumnInt64;
+            if (!columnType(item.second.get(), type) || type != cols[i].type)
+                return false;
+            const StringData& key = keys[i];
+            if (key.size() != item.first.size() || 0 != memcmp(key.data(), item.first.data(), key.size()))
+                return false;
+            ++i;
+        }
+
+        i = 0;
+        for (const auto& item : row)
+        {
+            Column& col = cols[i++];
+            switch (col.type)
+            {
+            case ColumnInt64:
+                col.ints.push_back(static_cast<const ValueNumber*>(item.second.get())->toInt64());
+                break;
+            case ColumnDecimal:
+                col.decs.push_back(static_cast<const ValueNumber*>(item.second.get())->toDecimal());
+                break;
+            case ColumnBoolean:
+                col.bools.push_back(static_cast<const ValueBoolean*>(item.second.get())->get() ? 1 : 0);
+                break;
+            case ColumnString:
+            {
+                const StringData& s = static_cast<const ValueString*>(item.second.get())->text();
+                col.chars.append(s.data(), s.size());
+                col.offsets.push_back(col.chars.size());
+                break;
+            }
+            }
+        }
+        ++count;
+        return true;
+    }
+
+    inline size_t rows() const { return count; }
+    inline size_t columns() const { return keys.size(); }
+    inline const StringData& key(size_t c) const { return keys[c]; }
+    inline const Column& column(size_t c) const { return cols[c]; }
+
+    // Column of key (case-insensitive, like object lookups), columns() if none
+    size_t find(const std::string& key) const
+    {
+        for (size_t c = 0; c < keys.size(); ++c)
+        {
+            if (Utils::equal<char>(keys[c].data(), keys[c].size(), key.data(), key.size(), true))
+                return c;
+        }
+        return keys.size();
+    }
+
+    // A new object with the values of a row
+    std::shared_ptr<ValueBase> row(size_t r) const
+    {
+        std::shared_ptr<ValueObject> p(ValueObject::create(keepOrder));
+        for (size_t c = 0; c < keys.size(); ++c)
+        {
+            const Column& col = cols[c];
+            ValueBase* v = nullptr;
+            switch (col.type)
+            {
+            case ColumnInt64:
+                v = ValueNumber::create(col.ints[r]);
+                break;
+            case ColumnDecimal:
+                v = ValueNumber::create(col.decs[r]);
+                break;
+            case ColumnBoolean:
+                v = ValueBoolean::create(0 != col.bools[r]);
+                break;
+            case ColumnString:
+            {
+                const char* s = nullptr;
+                size_t n = 0;
+                col.getString(r, s, n);
+                v = ValueString::create(StringData(std::string(s, n)));
+                break;
+            }
+            }
+            p->append(keys[c], std::shared_ptr<ValueBase>(v));
+        }
+        return p;
+    }
+
+    // Every row as an object, followed by tail. Built by the first call and
+    // kept, so that a const array can be iterated without changing it; safe
+    // from several threads. tail must be the same at each call.
+    const RowList& allRows(const RowList& tail) const
+    {
+        std::call_once(allOnce, [&]() {
+            RowList rows(tail.get_allocator());
+            rows.reserve(count + tail.size());
+            for (size_t r = 0; r < count; ++r)
+                rows.push_back(row(r));
+            rows.insert(rows.end(), tail.begin(), tail.end());
+            all = std::move(rows);
+        });
+        return all;
+    }
+
+private:
+    explicit ColumnTable(bool ko) : count(0), keepOrder(ko) {}
+
+    // Only numbers which fit in int64 or double, booleans and strings. A raw
+    // number keeps its text, which a column wouldn't.
+    static bool columnType(const ValueBase* v, ColumnType& type)
+    {
+        if (v->isNumber())
+        {
+            const ValueNumber* num = static_cast<const ValueNumber*>(v);
+            if (num->isRaw())
+                return false;
+            if (num->isDecimal())
+                type = ColumnDecimal;
+            else if (num->isSigned() || num->toUint64() <= 0x7FFFFFFFFFFFFFFFULL)
+                type = ColumnInt64;
+            else
+                return false;
+            return true;
+        }
+        if (v->isBoolean())
+        {
+            type = ColumnBoolean;
+            return true;
+        }
+        if (v->isString())
+        {
+            type = ColumnString;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    std::vector<StringData> keys;
+    std::vector<Column> cols;
+    size_t count;
+    bool keepOrder;
+    mutable std::once_flag allOnce;
+    mutable RowList all;
+};
+
+class ValueArray : public ValueBase
+{
+public:
+    virtual ~ValueArray() {}
+    virtual bool isArray() const { return true; }
+    virtual std::string serialize(SerializeConfig* config) const
+    {
+        std::string s("[");
+        if (config && config->isWellFormatted())
+        {
+            config->indentInc();
+            s.append(config->getLineEnding());
+        }
+        // By index, the rows of a columnar array are built one at a time
+        const size_t n = size();
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (0 != i)
+            {
+                s.append(",");
+                if (config && config->isWellFormatted())
+                    s.append(config->getLineEnding());
+            }
+
+            // Add indent
+            if (config && config->isWellFormatted() && config->getIndentSize() != 0)
+                s.append(config->getIndent().data(), config->getIndent().data() + config->getIndentSize());
+
+            // Value
+            s.append(get(i)->serialize(config));
+        }
+        if (config && config->isWellFormatted())
+        {
+            config->indentDec();
+            s.append(config->getLineEnding());
+            if (config->getIndentSize() != 0)
+                s.append(config->getIndent().data(), config->getIndent().data() + config->getIndentSize());
+        }
+        s.append("]");
+        return s;
+    }
+    virtual size_t size() const { load(); return rows() + vals.size(); }
+
+    typedef std::shared_ptr<ValueBase> value_type;
+    typedef ColumnTable::RowList container_type;
+
+    static ValueArray* create() { return new ValueArray(); }
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    // The node, the element vector and the values push_back() creates come
+    // from r
+    static std::shared_ptr<ValueArray> create(std::pmr::memory_resource* r)
+    {
+        return allocateNode<ValueArray>(r, [&](void* m) { return ::new (m) ValueArray(container_type::allocator_type(r)); });
+    }
+#endif
+
+    // Lazy array: the elements are read from s when first accessed
+    static ValueArray* createLazy(const char* s, size_t n, std::shared_ptr<void> owner, std::shared_ptr<const ParseConfig> config)
+    {
+        ValueArray* p = new ValueArray();
+        p->source = std::allocate_shared<LazySource>(ContainerAllocator<LazySource>(), s, n, owner, config);
+        return p;
+    }
+
+    typedef container_type::iterator iterator;
+    typedef container_type::const_iterator const_iterator;
+
+    inline bool isLoaded() const { return (nullptr == source || source->loaded.load(std::memory_order_acquire)); }
+    inline bool empty() const { return 0 == size(); }
+    inline void reserve(size_t n) { materialize(); vals.reserve(n); }
+    inline void clear() { source.reset(); table.reset(); vals.clear(); }
+    // Iterators need one object per element: a columnar array is converted,
+    // or for const iterators the rows are built once beside the columns
+    inline iterator begin() { materialize(); return vals.begin(); }
+    inline const_iterator begin() const { return elements().begin(); }
+    inline iterator end() { materialize(); return vals.end(); }
+    inline const_iterator end() const { return elements().end(); }
+
+    // The leading elements may be stored in columns: a row is then a new
+    // object built at each call, changing it doesn't change the array.
+    // at() converts the columns first, for elements which are modified.
+    std::shared_ptr<ValueBase> at(size_t index)
+    {
+        materialize();
+        return (index < vals.size()) ? vals[index] : std::shared_ptr<ValueBase>();
+    }
+
+    std::shared_ptr<ValueBase> get(size_t index) const
+    {
+        load();
+        const size_t r = rows();
+        if (index < r)
+            return table->row(index);
+        index -= r;
+        return (index < vals.size()) ? vals[index] : std::shared_ptr<ValueBase>();
+    }
+
+    // Columns of the leading elements, nullptr if none
+    inline const ColumnTable* getColumns() const { load(); return table.get(); }
+
+    // Parser: add an element without converting the columns
+    inline void append(std::shared_ptr<ValueBase> sp) { vals.push_back(std::move(sp)); }
+
+    // Parser: move the last element, an object, into the columns if all the
+    // elements before it are there already
+    void absorbLast()
+    {
+        if (vals.size() != 1 || !vals.back()->isObject())
+            return;
+        const ValueObject& row = *static_cast<const ValueObject*>(vals.back().get());
+        if (!table)
+        {
+            table.reset(ColumnTable::create(row));
+            if (!table)
+                return;
+        }
+        if (table->append(row))
+            vals.pop_back();
+    }
+
+    std::shared_ptr<ValueBase> push_back(std::shared_ptr<ValueBase> sp) { materialize(); vals.push_back(sp); return sp; }
+    std::shared_ptr<ValueBase> push_back(bool v) { return push_back(make<ValueBoolean>(v)); }
+    std::shared_ptr<ValueBase> push_back(int32_t v) { return push_back(make<ValueNumber>(v)); }
+    std::shared_ptr<ValueBase> push_back(int64_t v) { return push_back(make<ValueNumber>(v)); }
+    std::shared_ptr<ValueBase> push_back(uint32_t v) { return push_back(make<ValueNumber>(v)); }
+    std::shared_ptr<ValueBase> push_back(uint64_t v) { return push_back(make<ValueNumber>(v)); }
+    std::shared_ptr<ValueBase> push_back(float v) { return push_back(make<ValueNumber>(v)); }
+    std::shared_ptr<ValueBase> push_back(double v) { return push_back(make<ValueNumber>(v)); }
+    std::shared_ptr<ValueBase> push_back(const std::string& v) { return push_back(make<ValueString>(v, false)); }
+    std::shared_ptr<ValueBase> push_back(const std::wstring& v) { return push_back(make<ValueString>(v, false)); }
+
+    inline void load() const
+    {
+        if (!isLoaded())
+            expand();
+    }
+
+    // Read the elements of a lazy array, defined after Parser
+    void expand() const;
+
+private:
+    ValueArray() {}
+    explicit ValueArray(const container_type::allocator_type& alloc) : vals(alloc) {}
+
+    inline size_t rows() const { return table ? table->rows() : 0; }
+
+    // A new value for push_back(), from the resource of the elements if any
+    template<typename T, typename... Args>
+    std::shared_ptr<ValueBase> make(Args&&... args) const
+    {
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        if (nullptr != vals.get_allocator().getResource())
+            return T::create(std::forward<Args>(args)..., vals.get_allocator().getResource());
+#endif
+        return std::shared_ptr<ValueBase>(T::create(std::forward<Args>(args)...));
+    }
+
+    // All the elements, without changing a columnar array
+    const container_type& elements() const
+    {
+        load();
+        return table ? table->allRows(vals) : vals;
+    }
+
+    // Turn the columns back into one object per element
+    void materialize()
+    {
+        load();
+        if (!table)
+            return;
+        container_type all(vals.get_allocator());
+        all.reserve(table->rows() + vals.size());
+        for (size_t r = 0; r < table->rows(); ++r)
+            all.push_back(table->row(r));
+        all.insert(all.end(), vals.begin(), vals.end());
+        vals.swap(all);
+        table.reset();
+    }
+
+    // Elements are read on first access of a lazy array, even a const one
+    mutable container_type vals;
+    // From the arena of the document, like the node
+    mutable std::shared_ptr<LazySource> source;
+    // Leading elements stored as columns, followed by those in vals
+    std::unique_ptr<ColumnTable> table;
+};
+
+// A JSON number, converted to the narrowest of int64/uint64/double that holds it
+struct NumberToken
+{
+    enum Type { Int64, Uint64, Double };
+    Type type;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+    };
+};
+
+// Text to double for the cases the fast path cannot do exactly
+inline bool parseDecimal(const char* s, const char* end, double& v)
+{
+#ifdef JSONX_HAS_CHARCONV
+    const std::from_chars_result r = std::from_chars(s, end, v);
+    return (r.ec == std::errc());
+#else
+    // strtod() wants a null-terminated string using the locale's decimal point
+    char local[64];
+    std::string heap;
+    const size_t n = static_cast<size_t>(end - s);
+    char* p = local;
+    if (n >= sizeof(local))
+    {
+        heap.resize(n + 1);
+        p = &heap[0];
+    }
+    memcpy(p, s, n);
+    p[n] = 0;
+    const char point = localeconv()->decimal_point[0];
+    std::replace(p, p + n, '.', point);
+    errno = 0;
+    v = strtod(p, nullptr);
+    // ERANGE is also reported for subnormal results, only overflow fails
+    return (errno != ERANGE || (v != HUGE_VAL && v != -HUGE_VAL));
+#endif
+}
+
+// Scan the number at p and convert it without building a temporary string.
+//   number = [ minus ] int [ frac ] [ exp ]
+// On success p points right after the number.
+inline JsonError scanNumber(const char*& p, const char* end, NumberToken& num)
+{
+    static const double exact10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char* start = p;
+    const char* pos = p;
+    const bool minus = (pos < end && *pos == '-');
+    if (minus)
+        ++pos;
+
+    // int = zero / ( digit1-9 *DIGIT )
+    if (pos >= end)
+        return JEUnexpectedEnd;
+    if (*pos < '0' || *pos > '9')
+        return JEUnexpectedChar;
+
+    uint64_t mantissa = 0;
+    int digits = 0;         // significant digits accumulated into mantissa
+    bool truncated = false; // more significant digits than mantissa can hold
+    int64_t exponent = 0;
+    bool decimal = false;
+
+    if (*pos == '0')
+    {
+        ++pos;
+        if (pos < end && *pos >= '0' && *pos <= '9')
+            return JEUnexpectedChar;
+    }
+    else
+    {
+        do {
+            const uint64_t digit = static_cast<uint64_t>(*pos - '0');
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + digit;
+                ++digits;
+            }
+            else if (digits == 19 && mantissa <= (0xFFFFFFFFFFFFFFFFULL - digit) / 10)
+            {
+                mantissa = mantissa * 10 + digit;
+                ++digits;
+            }
+            else
+            {
+                truncated = true;
+                ++exponent;
+            }
+            ++pos;
+        } while (pos < end && *pos >= '0' && *pos <= '9');
+    }
+
+    // frac = decimal-point 1*DIGIT
+    if (pos < end && *pos == '.')
+    {
+        decimal = true;
+        ++pos;
+        const char* frac = pos;
+        while (pos < end && *pos >= '0' && *pos <= '9')
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*pos - '0');
+                if (mantissa != 0)
+                    ++digits;
+                --exponent;
+            }
+            else
+            {
+                truncated = true;
+            }
+            ++pos;
+        }
+        if (pos == frac)
+            return (pos >= end) ? JEUnexpectedEnd : JEUnexpectedChar;
+    }
+
+    // exp = e [ minus / plus ] 1*DIGIT
+    if (pos < end && (*pos == 'e' || *pos == 'E'))
+    {
+        decimal = true;
+        ++pos;
+        bool expMinus = false;
+        if (pos < end && (*pos == '+' || *pos == '-'))
+        {
+            expMinus = (*pos == '-');
+            ++pos;
+        }
+        const char* expStart = pos;
+        int64_t e = 0;
+        while (pos < end && *pos >= '0' && *pos <= '9')
+        {
+            if (e < 100000)
+                e = e * 10 + (*pos - '0');
+            ++pos;
+        }
+        if (pos == expStart)
+            return (pos >= end) ? JEUnexpectedEnd : JEUnexpectedChar;
+        exponent += expMinus ? -e : e;
+    }
+
+    p = pos;
+
+    if (!decimal && !truncated)
+    {
+        if (!minus)
+        {
+            if (mantissa <= 0x7FFFFFFFFFFFFFFFULL)
+            {
+                num.type = NumberToken::Int64;
+                num.i = static_cast<int64_t>(mantissa);
+            }
+            else
+            {
+                num.type = NumberToken::Uint64;
+                num.u = mantissa;
+            }
+            return JESuccess;
+        }
+        if (mantissa <= 0x8000000000000000ULL)
+        {
+            num.type = NumberToken::Int64;
+            num.i = static_cast<int64_t>(0 - mantissa);
+            return JESuccess;
+        }
+    }
+
+    num.type = NumberToken::Double;
+
+    // Clinger's fast path: both operands are exact doubles, so is the result
+    if (!truncated && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+    {
+        double d = static_cast<double>(mantissa);
+        if (exponent < 0)
+            d /= exact10[-exponent];
+        else
+            d *= exact10[exponent];
+        num.d = minus ? -d : d;
+        return JESuccess;
+    }
+
+    if (mantissa == 0 && !truncated)
+    {
+        num.d = minus ? -0.0 : 0.0;
+        return JESuccess;
+    }
+
+    if (!parseDecimal(start, pos, num.d))
+    {
+        // Underflow goes to zero, overflow is an error
+        if (exponent >= 0)
+            return JENumberOutOfRange;
+        num.d = minus ? -0.0 : 0.0;
+    }
+    return JESuccess;
+}
+
+inline void ValueNumber::convert() const
+{
+    // The text was validated when it was read
+    NumberToken num;
+    const char* p = raw.data();
+    scanNumber(p, p + raw.size(), num);
+    ValueNumber* self = const_cast<ValueNumber*>(this);
+    switch (num.type)
+    {
+    case NumberToken::Int64:
+        self->n = num.i;
+        self->valSigned = (num.i < 0);
+        break;
+    case NumberToken::Uint64:
+        self->u = num.u;
+        break;
+    default:
+        self->d = num.d;
+        self->valSigned = (num.d < 0);
+        self->valDecimal = true;
+        break;
+    }
+    pending = false;
+}
+
+inline unsigned trailingZeros(uint64_t x)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long r = 0;
+    _BitScanForward64(&r, x);
+    return r;
+#elif defined(_MSC_VER)
+    unsigned long r = 0;
+    if (_BitScanForward(&r, static_cast<unsigned long>(x)))
+        return r;
+    _BitScanForward(&r, static_cast<unsigned long>(x >> 32));
+    return r + 32;
+#else
+    return static_cast<unsigned>(__builtin_ctzll(x));
+#endif
+}
+
+// Stage 1 of the parser, as done by simdjson:
+//   https://arxiv.org/abs/1902.08318
+// The input is classified 64 bytes at a time into bitmasks (quotes, backslashes,
+// whitespace and operators), from which the positions of all structural
+// characters outside of strings are extracted: {}[],: , every opening quote and
+// the first character of every other scalar (numbers, true/false/null).
+// Escapes and string state are carried from one block to the next.
+class StructuralIndex
+{
+public:
+    StructuralIndex() {}
+    ~StructuralIndex() {}
+
+    inline bool empty() const { return positions.empty(); }
+    inline size_t size() const { return positions.size(); }
+    inline const uint32_t* data() const { return positions.data(); }
+    inline uint32_t operator [](size_t i) const { return positions[i]; }
+    inline void clear() { positions.clear(); }
+
+    // Split the top-level array in s into its elements without storing an
+    // index: every ',' at depth 1 and the closing bracket end one. Blank
+    // elements are skipped, onElement(begin, end) gets the others in order.
+    // Returns false if s is not a closed array.
+    template<typename Callback>
+    static bool splitArray(const char* s, size_t n, Callback onElement)
+    {
+        size_t i = 0;
+        while (i < n && isSpace(s[i]))
+            ++i;
+        if (i == n || '[' != s[i])
+            return false;
+
+        size_t depth = 0;
+        size_t start = 0;
+        Carry carry;
+        for (size_t base = 0; base < n; base += 64)
+        {
+            Masks m;
+            if (base + 64 <= n)
+            {
+                m = classify(s + base);
+            }
+            else
+            {
+                char tail[64];
+                memset(tail, ' ', sizeof(tail));
+                memcpy(tail, s + base, n - base);
+                m = classify(tail);
+            }
+            uint64_t quote = 0;
+            const uint64_t inString = strings(m, carry, quote);
+            uint64_t bits = m.op & ~(inString | quote);
+            while (bits)
+            {
+                const size_t p = base + trailingZeros(bits);
+                bits &= bits - 1;
+                switch (s[p])
+                {
+                case '[':
+                case '{':
+                    if (0 == depth++)
+                        start = p + 1;
+                    break;
+                case ']':
+                case '}':
+                    if (0 == depth)
+                        return false;
+                    if (0 == --depth)
+                    {
+                        // Nested brackets are checked when the element is
+                        // parsed, the outer one has to match here
+                        if (']' != s[p])
+                            return false;
+                        element(s, start, p, onElement);
+                        return true;
+                    }
+                    break;
+                case ',':
+                    if (1 == depth)
+                    {
+                        element(s, start, p, onElement);
+                        start = p + 1;
+                    }
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool build(const char* s, size_t n)
+    {
+        positions.clear();
+        if (n > 0xFFFFFFFFULL)
+            return false;
+
+        positions.reserve(n / 4 + 8);
+        Carry carry;
+        size_t i = 0;
+        for (; i + 64 <= n; i += 64)
+            extract(classify(s + i), carry, i);
+        if (i < n)
+        {
+            // Pad the last block with whitespace
+            char tail[64];
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, s + i, n - i);
+            extract(classify(tail), carry, i);
+        }
+        return true;
+    }
+
+#ifndef _DEBUG
+private:
+#endif
+    struct Masks
+    {
+        uint64_t quote;
+        uint64_t backslash;
+        uint64_t space;
+        uint64_t op;
+    };
+
+    struct Carry
+    {
+        Carry() : oddBackslash(0), inString(0), scalar(0) {}
+        uint64_t oddBackslash;
+        uint64_t inString;
+        uint64_t scalar;
+    };
+
+    // Bit i of the result is the parity of bits [0, i] of x
+    static inline uint64_t prefixXor(uint64_t x)
+    {
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+        return x;
+    }
+
+#if defined(JSONX_SIMD_AVX2)
+    static inline uint64_t eq(__m256i lo, __m256i hi, char c)
+    {
+        const __m256i v = _mm256_set1_epi8(c);
+        const uint64_t l = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, v)));
+        const uint64_t h = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, v)));
+        return l | (h << 32);
+    }
+
+    static inline Masks classify(const char* p)
+    {
+        const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+        // '[' | 0x20 == '{' and ']' | 0x20 == '}'
+        const __m256i bit5 = _mm256_set1_epi8(0x20);
+        const __m256i lo5 = _mm256_or_si256(lo, bit5);
+        const __m256i hi5 = _mm256_or_si256(hi, bit5);
+        Masks m;
+        m.quote = eq(lo, hi, '\"');
+        m.backslash = eq(lo, hi, '\\');
+        m.space = eq(lo, hi, ' ') | eq(lo, hi, '\t') | eq(lo, hi, '\n') | eq(lo, hi, '\r');
+        m.op = eq(lo5, hi5, '{') | eq(lo5, hi5, '}') | eq(lo, hi, ',') | eq(lo, hi, ':');
+        return m;
+    }
+#elif defined(JSONX_SIMD_SSE2)
+    static inline uint64_t eq(const __m128i* v, char c)
+    {
+        const __m128i x = _mm_set1_epi8(c);
+        const uint64_t m0 = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v[0], x)));
+        const uint64_t m1 = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v[1], x)));
+        const uint64_t m2 = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v[2], x)));
+        const uint64_t m3 = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v[3], x)));
+        return m0 | (m1 << 16) | (m2 << 32) | (m3 << 48);
+    }
+
+    static inline Masks classify(const char* p)
+    {
+        __m128i v[4];
+        __m128i v5[4];
+        // '[' | 0x20 == '{' and ']' | 0x20 == '}'
+        const __m128i bit5 = _mm_set1_epi8(0x20);
+        for (int i = 0; i < 4; ++i)
+        {
+            v[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+            v5[i] = _mm_or_si128(v[i], bit5);
+        }
+        Masks m;
+        m.quote = eq(v, '\"');
+        m.backslash = eq(v, '\\');
+        m.space = eq(v, ' ') | eq(v, '\t') | eq(v, '\n') | eq(v, '\r');
+        m.op = eq(v5, '{') | eq(v5, '}') | eq(v, ',') | eq(v, ':');
+        return m;
+    }
+#else
+    static inline Masks classify(const char* p)
+    {
+        Masks m = { 0, 0, 0, 0 };
+        for (int i = 0; i < 64; ++i)
+        {
+            const uint64_t bit = 1ULL << i;
+            switch (p[i])
+            {
+            case '\"': m.quote |= bit; break;
+            case '\\': m.backslash |= bit; break;
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r': m.space |= bit; break;
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ',':
+            case ':': m.op |= bit; break;
+            default: break;
+            }
+        }
+        return m;
+    }
+#endif
+
+    static inline bool isSpace(char c)
+    {
+        return (c == ' ' || c == '\n' || c == '\r' || c == '\t');
+    }
+
+    template<typename Callback>
+    static inline void element(const char* s, size_t begin, size_t end, Callback& onElement)
+    {
+        size_t i = begin;
+        while (i < end && isSpace(s[i]))
+            ++i;
+        if (i < end)
+            onElement(begin, end);
+    }
+
+    // Characters preceded by an odd-length run of backslashes
+    static inline uint64_t escapedChars(uint64_t bs, Carry& carry)
+    {
+        const uint64_t evenBits = 0x5555555555555555ULL;
+        const uint64_t oddBits = ~evenBits;
+        const uint64_t startEdges = bs & ~(bs << 1);
+        const uint64_t evenStartMask = evenBits ^ carry.oddBackslash;
+        const uint64_t evenStarts = startEdges & evenStartMask;
+        const uint64_t oddStarts = startEdges & ~evenStartMask;
+        const uint64_t evenCarries = bs + evenStarts;
+        uint64_t oddCarries = bs + oddStarts;
+        const bool overflow = (oddCarries < bs);
+        oddCarries |= carry.oddBackslash;
+        carry.oddBackslash = overflow ? 1 : 0;
+        const uint64_t evenCarryEnds = evenCarries & ~bs;
+        const uint64_t oddCarryEnds = oddCarries & ~bs;
+        return (evenCarryEnds & oddBits) | (oddCarryEnds & evenBits);
+    }
+
+    // Unescaped quotes, and the return value marks the strings: from opening
+    // quote (included) to closing quote (excluded)
+    static inline uint64_t strings(const Masks& m, Carry& carry, uint64_t& quote)
+    {
+        quote = m.quote & ~escapedChars(m.backslash, carry);
+        const uint64_t inString = prefixXor(quote) ^ carry.inString;
+        carry.inString = (inString >> 63) ? ~0ULL : 0ULL;
+        return inString;
+    }
+
+    inline void extract(const Masks& m, Carry& carry, size_t base)
+    {
+        uint64_t quote = 0;
+        const uint64_t inString = strings(m, carry, quote);
+        const uint64_t outside = ~(inString | quote);
+        const uint64_t scalar = ~(m.op | m.space | quote) & outside;
+        const uint64_t scalarStart = scalar & ~((scalar << 1) | carry.scalar);
+        carry.scalar = scalar >> 63;
+
+        uint64_t bits = (m.op & outside) | (quote & inString) | scalarStart;
+        while (bits)
+        {
+            positions.push_back(static_cast<uint32_t>(base + trailingZeros(bits)));
+            bits &= bits - 1;
+        }
+    }
+
+private:
+    std::vector<uint32_t> positions;
+};
+
+// Whole file mapped copy-on-write. In-situ parsing may write to it without
+// touching the file, pages it doesn't write stay shared with the page cache.
+class MappedFile
+{
+public:
+    MappedFile()
+        : addr(nullptr), len(0)
+    {
+    }
+    ~MappedFile()
+    {
+        close();
+    }
+
+    bool open(const std::string& file, bool populate = false)
+    {
+        close();
+#if defined(_WIN32)
+        (void)populate;
+        HANDLE hFile = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (INVALID_HANDLE_VALUE == hFile)
+            return false;
+        LARGE_INTEGER li;
+        if (GetFileSizeEx(hFile, &li) && static_cast<uint64_t>(li.QuadPart) <= static_cast<uint64_t>(SIZE_MAX))
+        {
+            len = static_cast<size_t>(li.QuadPart);
+            HANDLE hMap = (0 != len) ? CreateFileMappingA(hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL) : NULL;
+            if (NULL != hMap)
+            {
+                addr = static_cast<char*>(MapViewOfFile(hMap, FILE_MAP_COPY, 0, 0, 0));
+                CloseHandle(hMap);
+            }
+        }
+        // The view stays valid without the handles
+        CloseHandle(hFile);
+        if (0 != len && nullptr == addr)
+        {
+            len = 0;
+            return false;
+        }
+#else
+        const int fd = ::open(file.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (0 != fstat(fd, &st) || !S_ISREG(st.st_mode) || static_cast<uint64_t>(st.st_size) > static_cast<uint64_t>(SIZE_MAX))
+        {
+            ::close(fd);
+            return false;
+        }
+        len = static_cast<size_t>(st.st_size);
+        if (0 != len)
+        {
+            int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+            if (populate)
+                flags |= MAP_POPULATE;
+#else
+            (void)populate;
+#endif
+            void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, flags, fd, 0);
+            if (MAP_FAILED != p)
+            {
+                addr = static_cast<char*>(p);
+                madvise(p, len, MADV_SEQUENTIAL);
+            }
+        }
+        // The mapping stays valid without the descriptor
+        ::close(fd);
+        if (0 != len && nullptr == addr)
+        {
+            len = 0;
+            return false;
+        }
+#endif
+        return true;
+    }
+
+    void close()
+    {
+#if defined(_WIN32)
+        if (addr)
+            UnmapViewOfFile(addr);
+#else
+        if (addr)
+            munmap(addr, len);
+#endif
+        addr = nullptr;
+        len = 0;
+    }
+
+    inline char* data() const { return addr; }
+    inline size_t size() const { return len; }
+
+private:
+    // Non-copyable
+    MappedFile(const MappedFile& rhs);
+    MappedFile& operator = (const MappedFile& rhs);
+
+private:
+    char* addr;
+    size_t len;
 };
 
 class Parser
 {
 public:
-    Parser(std::istream& s)
-        : stm(s), pos(0), error(JESuccess)
+    Parser(const char* s, size_t n, const ParseConfig* config = nullptr)
+        : stm(nullptr), buf(s), bufSize(n), insitu(nullptr), pos(0), error(JESuccess), indexed(false), idxPos(0), lazy(false), maxDepth(ParseConfig::DefaultMaxDepth), duplicateKeys(DuplicateLastWins)
+        , pool(nullptr), internLength(0), columnar(false), rawNumbers(false), arenaEnabled(false)
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        , resource(nullptr)
+#endif
+    {
+        configure(config);
+    }
+    // Stream adapter: the whole stream is read into an internal buffer first,
+    // the parser itself always works on contiguous memory.
+    Parser(std::istream& s, const ParseConfig* config = nullptr)
+        : stm(&s), buf(nullptr), bufSize(0), insitu(nullptr), pos(0), error(JESuccess), indexed(false), idxPos(0), lazy(false), maxDepth(ParseConfig::DefaultMaxDepth), duplicateKeys(DuplicateLastWins)
+        , pool(nullptr), internLength(0), columnar(false), rawNumbers(false), arenaEnabled(false)
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        , resource(nullptr)
+#endif
+    {
+        fill();
+        configure(config);
+    }
+    virtual ~Parser() {}
+
+    inline size_t getPos() const { return pos; }
+    inline JsonError getError() const { return error; }
+    inline bool failed() const { return (0 != error); }
+    virtual void reset()
+    {
+        if (stm)
+        {
+            const bool wasIndexed = indexed;
+            stm->clear();
+            stm->seekg(0);
+            fill();
+            if (wasIndexed)
+                buildIndex();
+        }
+        pos = 0;
+        idxPos = 0;
+        error = JESuccess;
+    }
+
+    // Build the structural index of the whole buffer. Whitespace between
+    // tokens is then skipped by jumping to the next indexed position.
+    bool buildIndex()
+    {
+        indexed = index.build(buf, bufSize);
+        idxPos = 0;
+        return indexed;
+    }
+
+    inline bool isIndexed() const { return indexed; }
+
+    ValueType checkValueType()
+    {
+        char c = peekNextNotSpace();
+        switch (c)
+        {
+        case 'n':
+        case 'N':
+            return JsonNull;
+        case 't':
+        case 'T':
+        case 'f':
+        case 'F':
+            return JsonBoolean;
+        case '-':
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            return JsonNumber;
+        case '\"':
+            return JsonString;
+        case '{':
+            return JsonObject;
+        case '[':
+            return JsonArray;
+        default:
+            break;
+        }
+        return JsonUnknown;
+    }
+
+    IMPLEMENT::ValueBase* readValue()
+    {
+        const ValueType type = checkValueType();
+
+        switch (type)
+        {
+        case JsonNull:
+            return readValueNull();
+        case JsonBoolean:
+            return readValueBoolean();
+        case JsonNumber:
+            return rawNumbers ? readRawNumber() : readValueNumber();
+        case JsonString:
+            return readValueString();
+        case JsonObject:
+            return lazy ? readLazyContainer(true) : readContainer();
+        case JsonArray:
+            return lazy ? readLazyContainer(false) : readContainer();
+        default:
+            break;
+        }
+
+        error = JEUnexpectedChar;
+        return nullptr;
+    }
+
+    // The document root. With an arena, the nodes and strings of the
+    // document are allocated from a new one, which the nodes keep alive. Its
+    // first block is sized for the buffer, small documents such as JSON lines
+    // don't take a whole block each.
+    std::shared_ptr<IMPLEMENT::ValueBase> readRoot()
+    {
+        openArena(rootBlock());
+        return readInArena([this]() { return readValue(); });
+    }
+
+    // Same with only the paths selected by node, nullptr if none is
+    std::shared_ptr<IMPLEMENT::ValueBase> readRoot(const Projection::Node& node)
+    {
+        openArena(rootBlock());
+        return readInArena([&]() { return readValue(node); });
+    }
+
+    // The next value, its nodes and strings come from shared (nullptr: none),
+    // e.g. one arena for several small documents
+    std::shared_ptr<IMPLEMENT::ValueBase> readShared(std::shared_ptr<IMPLEMENT::Arena> shared)
+    {
+        arena = std::move(shared);
+        return readInArena([this]() { return readValue(); });
+    }
+
+    // Arena for the nodes read with config, nullptr if it doesn't use one
+    static std::shared_ptr<IMPLEMENT::Arena> createArena(const ParseConfig* config, size_t block = 0x10000)
+    {
+        if (nullptr == config)
+            return std::shared_ptr<IMPLEMENT::Arena>();
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        if (nullptr != config->getMemoryResource())
+            return IMPLEMENT::Arena::create(config->getMemoryResource(), block);
+#endif
+        return config->useArena() ? IMPLEMENT::Arena::create(block) : std::shared_ptr<IMPLEMENT::Arena>();
+    }
+
+    // First arena block of a document, a stream is read in pieces
+    inline size_t rootBlock() const
+    {
+        return (nullptr != stm) ? 0x10000 : (std::min)(static_cast<size_t>(0x10000), 256 + bufSize * 16);
+    }
+
+    // Shared pointer of a new node, from arena if any
+    static std::shared_ptr<IMPLEMENT::ValueBase> adopt(IMPLEMENT::ValueBase* p, const std::shared_ptr<IMPLEMENT::Arena>& arena)
+    {
+        if (!arena)
+            return std::shared_ptr<IMPLEMENT::ValueBase>(p);
+        return std::shared_ptr<IMPLEMENT::ValueBase>(p, IMPLEMENT::ArenaDeleter(), IMPLEMENT::ArenaAllocator<IMPLEMENT::ValueBase>(arena));
+    }
+
+    // Lazy mode: objects and arrays are only validated, their members are
+    // read when first accessed, with config. owner keeps the buffer alive
+    // for that.
+    void setLazy(std::shared_ptr<void> owner, std::shared_ptr<const ParseConfig> config = std::shared_ptr<const ParseConfig>())
+    {
+        lazy = true;
+        lazyOwner = owner;
+        lazyConfig = config;
+    }
+
+    inline bool isLazy() const { return lazy; }
+
+    // Read the members of a lazy object/array from the whole buffer. With an
+    // arena, they come from a new one sized for the text, returned in nodes.
+    bool expand(IMPLEMENT::ValueObject* pObject, std::shared_ptr<IMPLEMENT::Arena>& nodes)
+    {
+        openArena((std::min)(static_cast<size_t>(0x10000), 256 + bufSize * 16));
+        IMPLEMENT::Arena::Scope scope(arena.get());
+        const bool ok = readMembers(pObject);
+        nodes.swap(arena);
+        return ok;
+    }
+
+    bool expand(IMPLEMENT::ValueArray* pArray, std::shared_ptr<IMPLEMENT::Arena>& nodes)
+    {
+        openArena((std::min)(static_cast<size_t>(0x10000), 256 + bufSize * 16));
+        IMPLEMENT::Arena::Scope scope(arena.get());
+        const bool ok = readElements(pArray);
+        nodes.swap(arena);
+        return ok;
+    }
+
+    // SAX mode: report the next value to handler as events, no tree is built.
+    // See BaseHandler for the events. Strings are passed as views which are
+    // only valid during the call.
+    template<typename Handler>
+    bool readValue(Handler& handler)
+    {
+        // Open containers are kept in levels, not on the call stack
+        const size_t base = levels.size();
+        char c = peekNextNotSpace();
+
+        do {
+
+            if (c == '{' || c == '[')
+            {
+                if (!checkDepth(levels.size() - base))
+                    break;
+                readNext();
+                if (!notify(('{' == c) ? handler.startObject() : handler.startArray()))
+                    break;
+                levels.push_back(Level('{' == c));
+            }
+            else
+            {
+                if (!readScalar(handler))
+                    break;
+                if (levels.size() > base)
+                    ++levels.back().count;
+            }
+
+            // Move to the next value, closing the containers which end
+            bool ok = true;
+            while (levels.size() > base)
+            {
+                c = peekNextNotSpace();
+                if (eof())
+                {
+                    error = JEUnexpectedEnd;
+                    ok = false;
+                    break;
+                }
+
+                const Level level = levels.back();
+                if (c == (level.object ? '}' : ']'))
+                {
+                    readNext();
+                    levels.pop_back();
+                    if (!notify(level.object ? handler.endObject(level.count) : handler.endArray(level.count)))
+                    {
+                        ok = false;
+                        break;
+                    }
+                    if (levels.size() > base)
+                        ++levels.back().count;
+                    continue;
+                }
+
+                if (c == ',')
+                {
+                    readNext();
+                    continue;
+                }
+
+                if (level.object)
+                {
+                    if ('\"' != c)
+                    {
+                        error = JEUnexpectedChar;
+                        ok = false;
+                        break;
+                    }
+
+                    // Read key
+                    const char* key = nullptr;
+                    size_t n = 0;
+                    if (!readStringView(key, n) || !notify(handler.key(key, n)))
+                    {
+                        ok = false;
+                        break;
+                    }
+
+                    // Read colon
+                    c = peekNextNotSpace();
+                    if (c != ':')
+                    {
+                        error = eof() ? JEUnexpectedEnd : JEMissingColon;
+                        ok = false;
+                        break;
+                    }
+                    readNext();
+                    c = peekNextNotSpace();
+                }
+                break;
+            }
+
+            if (!ok)
+                break;
+            if (levels.size() == base)
+                return true;
+
+        } while (true);
+
+        levels.resize(base, Level(false));
+        return false;
+    }
+
+    // Projection: only what node selects is built, everything else is
+    // skipped. Returns nullptr without an error if nothing is selected.
+    IMPLEMENT::ValueBase* readValue(const Projection::Node& node)
+    {
+        if (node.isWhole())
+            return readValue();
+
+        const ValueType type = checkValueType();
+        if (type == JsonObject)
+            return readProjectedObject(node);
+        if (type == JsonArray)
+            return readProjectedArray(node);
+        if (type == JsonUnknown)
+            error = JEUnexpectedChar;
+        else
+            skipValue();
+        return nullptr;
+    }
+
+    // Pass over one complete value without building, decoding or allocating
+    // anything: strings are only scanned for their end and escapes checked,
+    // numbers only for their syntax. Nesting is tracked with one bit per
+    // level instead of recursion. Accepts exactly what readValue() accepts,
+    // unless strict: then the input has to be JSON as in RFC 8259, with
+    // string contents in valid UTF-8, lower case literals and exactly one ','
+    // between the members or elements of a container.
+    bool skipValue(bool strict = false)
+    {
+        // Object bit of the first 256 levels, the rest go to nesting
+        uint64_t local[4] = { 0, 0, 0, 0 };
+        size_t depth = 0;
+        bool object = false;
+        // Separators of the innermost container: a value was just read, or a ','
+        bool afterValue = false;
+        bool afterComma = false;
+
+        do {
+
+            char c = peekNextNotSpace();
+            if (depth > 0)
+            {
+                if (eof())
+                {
+                    error = JEUnexpectedEnd;
+                    return false;
+                }
+
+                // End of the innermost container
+                if (c == (object ? '}' : ']'))
+                {
+                    if (strict && afterComma)
+                    {
+                        error = JEUnexpectedChar;
+                        return false;
+                    }
+                    readNext();
+                    if (0 == --depth)
+                        return true;
+                    object = isObjectLevel(local, depth - 1);
+                    afterValue = true;
+                    afterComma = false;
+                    continue;
+                }
+
+                if (c == ',')
+                {
+                    if (strict && !afterValue)
+                    {
+                        error = JEUnexpectedChar;
+                        return false;
+                    }
+                    readNext();
+                    afterValue = false;
+                    afterComma = true;
+                    continue;
+                }
+
+                // Two values without a ',' between them
+                if (strict && afterValue)
+                {
+                    error = JEUnexpectedChar;
+                    return false;
+                }
+
+                if (object)
+                {
+                    if ('\"' != c)
+                    {
+                        error = JEUnexpectedChar;
+                        return false;
+                    }
+                    if (!skipString(strict))
+                        return false;
+                    c = peekNextNotSpace();
+                    if (c != ':')
+                    {
+                        error = eof() ? JEUnexpectedEnd : JEMissingColon;
+                        return false;
+                    }
+                    readNext();
+                    c = peekNextNotSpace();
+                }
+            }
+
+            if (strict && (c == 'N' || c == 'T' || c == 'F'))
+            {
+                error = JEUnexpectedChar;
+                return false;
+            }
+
+            switch (c)
+            {
+            case '{':
+            case '[':
+                if (!checkDepth(depth))
+                    return false;
+                readNext();
+                object = ('{' == c);
+                setObjectLevel(local, depth++, object);
+                afterValue = false;
+                afterComma = false;
+                continue;
+            case '\"':
+                if (!skipString(strict))
+                    return false;
+                break;
+            case 'n':
+            case 'N':
+                if (!readNull())
+                    return false;
+                break;
+            case 't':
+            case 'T':
+            case 'f':
+            case 'F':
+            {
+                bool v = false;
+                if (!readBoolean(v))
+                    return false;
+                break;
+            }
+            case '-':
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+                if (!skipNumber())
+                    return false;
+                break;
+            default:
+                error = JEUnexpectedChar;
+                return false;
+            }
+
+            if (0 == depth)
+                return true;
+            afterValue = true;
+            afterComma = false;
+
+        } while (true);
+    }
+
+#ifndef _DEBUG
+protected:
+#endif
+    Parser()
+        : stm(nullptr), buf(nullptr), bufSize(0), insitu(nullptr), pos(0), error(JESuccess), indexed(false), idxPos(0), lazy(false), maxDepth(ParseConfig::DefaultMaxDepth), duplicateKeys(DuplicateLastWins)
+        , pool(nullptr), internLength(0), columnar(false), rawNumbers(false), arenaEnabled(false)
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        , resource(nullptr)
+#endif
+    {
+    }
+
+    void configure(const ParseConfig* config)
+    {
+        maxDepth = config ? config->getMaxDepth() : static_cast<size_t>(ParseConfig::DefaultMaxDepth);
+        duplicateKeys = config ? config->getDuplicateKeys() : DuplicateLastWins;
+        pool = config ? config->getStringPool() : nullptr;
+        internLength = config ? config->getInternLength() : 0;
+        columnar = config ? config->useColumnar() : false;
+        rawNumbers = config ? config->useRawNumbers() : false;
+        arenaEnabled = config ? config->useArena() : false;
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        resource = config ? config->getMemoryResource() : nullptr;
+        if (nullptr != resource)
+            arenaEnabled = true;
+#endif
+        if (config && config->useStructuralIndex())
+            buildIndex();
+    }
+
+    // Members are appended as they are read, duplicates resolved at the end
+    inline bool buildObject(IMPLEMENT::ValueObject* pObject)
+    {
+        if (pObject->build(duplicateKeys))
+            return true;
+        error = JEDuplicateKey;
+        return false;
+    }
+
+    // Shared pointer of a new node, from the arena of readRoot() if any
+    inline std::shared_ptr<IMPLEMENT::ValueBase> adopt(IMPLEMENT::ValueBase* p)
+    {
+        return adopt(p, arena);
+    }
+
+    // A new arena for the document read next, if the config uses one; block
+    // is the size of its first block
+    void openArena(size_t block = 0x10000)
+    {
+        if (!arenaEnabled)
+            return;
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        arena = IMPLEMENT::Arena::create(resource, block);
+#else
+        arena = IMPLEMENT::Arena::create(block);
+#endif
+    }
+
+    inline void closeArena() { arena.reset(); }
+    inline IMPLEMENT::Arena* getArena() const { return arena.get(); }
+    inline bool useRawNumbers() const { return rawNumbers; }
+
+    // Reads with the arena current, the result is adopted by it
+    template<typename Read>
+    std::shared_ptr<IMPLEMENT::ValueBase> readInArena(Read read)
+    {
+        IMPLEMENT::ValueBase* p = nullptr;
+        {
+            IMPLEMENT::Arena::Scope scope(arena.get());
+            p = read();
+        }
+        std::shared_ptr<IMPLEMENT::ValueBase> sp;
+        if (nullptr != p)
+            sp = adopt(p);
+        arena.reset();
+        return sp;
+    }
+
+    inline bool checkDepth(size_t depth)
+    {
+        if (0 != maxDepth && depth >= maxDepth)
+        {
+            error = JEMaxDepthExceeded;
+            return false;
+        }
+        return true;
+    }
+
+    void assign(const char* s, size_t n)
+    {
+        buf = s;
+        bufSize = n;
+        insitu = nullptr;
+        pos = 0;
+        error = JESuccess;
+        indexed = false;
+        idxPos = 0;
+        index.clear();
+    }
+
+    // Strings are decoded in place inside s, which is modified
+    void assignInSitu(char* s, size_t n)
+    {
+        assign(s, n);
+        insitu = s;
+    }
+
+    void fill()
+    {
+        streamBuf.clear();
+        const std::streampos beg = stm->tellg();
+        if (beg != std::streampos(-1) && stm->seekg(0, std::ios::end))
+        {
+            const std::streampos end = stm->tellg();
+            if (end > beg)
+                streamBuf.reserve(static_cast<size_t>(end - beg));
+            stm->seekg(beg);
+        }
+        char chunk[16384];
+        while (stm->read(chunk, sizeof(chunk)) || stm->gcount() > 0)
+            streamBuf.append(chunk, static_cast<size_t>(stm->gcount()));
+        assign(streamBuf.data(), streamBuf.size());
+    }
+
+    static inline bool isSpace(char c)
+    {
+        return (c == ' ' || c == '\n' || c == '\r' || c == '\t');
+    }
+
+    inline bool eof() const
+    {
+        return (pos >= bufSize);
+    }
+
+    inline char peekNext() const
+    {
+        return (pos < bufSize) ? buf[pos] : -1;
+    }
+
+    inline char readNext()
+    {
+        return (pos < bufSize) ? buf[pos++] : -1;
+    }
+
+    inline char peekNextNotSpace()
+    {
+        if (pos < bufSize && isSpace(buf[pos]))
+        {
+            if (indexed)
+            {
+                // Everything between here and the next structural position
+                // is whitespace
+                const size_t n = index.size();
+                while (idxPos < n && index[idxPos] < pos)
+                    ++idxPos;
+                pos = (idxPos < n) ? index[idxPos] : bufSize;
+            }
+            else
+            {
+                do {
+                    ++pos;
+                } while (pos < bufSize && isSpace(buf[pos]));
+            }
+        }
+        return peekNext();
+    }
+
+    bool readNull()
+    {
+        // null
+        do {
+            char c = readNext();
+            if (c != 'n' && c != 'N')
+            {
+                error = JEMismatchValueType;
+                break;
+            }
+            c = readNext();
+            if (c != 'u')
+            {
+                error = JEUnexpectedChar;
+                break;
+            }
+            c = readNext();
+            if (c != 'l')
+            {
+                error = JEUnexpectedChar;
+                break;
+            }
+            c = readNext();
+            if (c != 'l')
+            {
+                error = JEUnexpectedChar;
+                break;
+            }
+        } while (false);
+        return !failed();
+    }
+
+    IMPLEMENT::ValueNull* readValueNull()
+    {
+        return readNull() ? IMPLEMENT::ValueNull::create() : nullptr;
+    }
+
+    bool readBoolean(bool& result)
+    {
+        // true/false
+        result = false;
+        do {
+            char c = readNext();
+            if (c == 't' || c == 'T')
+            {
+                c = readNext();
+                if (c != 'r')
+                {
+                    error = JEUnexpectedChar;
+                    break;
+                }
+                c = readNext();
+                if (c != 'u')
+                {
+                    error = JEUnexpectedChar;
+                    break;
+                }
+                c = readNext();
+                if (c != 'e')
+                {
+                    error = JEUnexpectedChar;
+                    break;
+                }
+                result = true;
+            }
+            else if (c == 'f' || c == 'F')
+            {
+                c = readNext();
+                if (c != 'a')
+                {
+                    error = JEUnexpectedChar;
+                    break;
+                }
+                c = readNext();
+                if (c != 'l')
+                {
+                    error = JEUnexpectedChar;
+                    break;
+                }
+                c = readNext();
+                if (c != 's')
+                {
+                    error = JEUnexpectedChar;
+                    break;
+                }
+                c = readNext();
+                if (c != 'e')
+                {
+                    error = JEUnexpectedChar;
+                    break;
+                }
+                result = false;
+            }
+            else
+            {
+                error = JEMismatchValueType;
+            }
+        } while (false);
+
+        return !failed();
+    }
+
+    IMPLEMENT::ValueBoolean* readValueBoolean()
+    {
+        bool result = false;
+        return readBoolean(result) ? IMPLEMENT::ValueBoolean::create(result) : nullptr;
+    }
+
+    bool readNumber(NumberToken& num)
+    {
+        peekNextNotSpace();
+        const char* p = buf + pos;
+        const JsonError e = scanNumber(p, buf + bufSize, num);
+        pos = static_cast<size_t>(p - buf);
+        if (JESuccess != e)
+        {
+            error = e;
+            return false;
+        }
+        return true;
+    }
+
+    IMPLEMENT::ValueNumber* readValueNumber()
+    {
+        // Number = [minus] int [frac] [exp]
+        // {
+        //    decimal - point = %x2E; .
+        //    digit1 - 9 = %x31 - 39; 1 - 9
+        //    e = %x65 / %x45; e E
+        //    exp = e[minus / plus] 1 * DIGIT
+        //    frac = decimal - point 1 * DIGIT
+        //    int = zero / (digit1 - 9 * DIGIT)
+        //    minus = %x2D; -
+        //    plus = %x2B; +
+        //    zero = %x30; 0
+        // }
+
+        NumberToken num;
+        if (!readNumber(num))
+            return nullptr;
+
+        switch (num.type)
+        {
+        case NumberToken::Int64:
+            return IMPLEMENT::ValueNumber::create(num.i);
+        case NumberToken::Uint64:
+            return IMPLEMENT::ValueNumber::create(num.u);
+        default:
+            break;
+        }
+        return IMPLEMENT::ValueNumber::create(num.d);
+    }
+
+    // The text is checked, kept and converted on first use
+    IMPLEMENT::ValueNumber* readRawNumber()
+    {
+        peekNextNotSpace();
+        const size_t start = pos;
+        if (!skipNumber())
+            return nullptr;
+        const size_t n = pos - start;
+        if (insitu)
+            return IMPLEMENT::ValueNumber::createRaw(StringData::borrow(insitu + start, n));
+        if (arena)
+            return IMPLEMENT::ValueNumber::createRaw(StringData::borrow(arena->copy(buf + start, n), n));
+        return IMPLEMENT::ValueNumber::createRaw(StringData(std::string(buf + start, n)));
+    }
+
+    // Position of the next '"', '\\' or control character at or after p
+    inline size_t scanString(size_t p) const
+    {
+#if defined(JSONX_SIMD_AVX2)
+        const __m256i quote32 = _mm256_set1_epi8('\"');
+        const __m256i backslash32 = _mm256_set1_epi8('\\');
+        const __m256i control32 = _mm256_set1_epi8(0x1F);
+        while (p + 32 <= bufSize)
+        {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf + p));
+            const __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote32), _mm256_cmpeq_epi8(v, backslash32)),
+                                              _mm256_cmpeq_epi8(_mm256_min_epu8(v, control32), v));
+            const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(m));
+            if (mask)
+                return p + trailingZeros(mask);
+            p += 32;
+        }
+#endif
+#if defined(JSONX_SIMD_SSE2)
+        const __m128i quote16 = _mm_set1_epi8('\"');
+        const __m128i backslash16 = _mm_set1_epi8('\\');
+        const __m128i control16 = _mm_set1_epi8(0x1F);
+        while (p + 16 <= bufSize)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + p));
+            const __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote16), _mm_cmpeq_epi8(v, backslash16)),
+                                           _mm_cmpeq_epi8(_mm_min_epu8(v, control16), v));
+            const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(m));
+            if (mask)
+                return p + trailingZeros(mask);
+            p += 16;
+        }
+#endif
+        while (p < bufSize)
+        {
+            const unsigned char c = static_cast<unsigned char>(buf[p]);
+            if (c == '\"' || c == '\\' || c < 0x20)
+                break;
+            ++p;
+        }
+        return p;
+    }
+
+    // Read a quoted string and append its decoded (UTF-8) content to s.
+    // Unescaped runs are copied in bulk, escapes are decoded in the same pass.
+    bool readString(std::string& s)
+    {
+        char c = readNext();
+        if (c != '\"')
+        {
+            error = JEMismatchValueType;
+            return false;
+        }
+
+        do {
+
+            const size_t start = pos;
+            pos = scanString(pos);
+            s.append(buf + start, pos - start);
+
+            if (eof())
+            {
+                error = JEUnexpectedEnd;
+                return false;
+            }
+
+            c = readNext();
+
+            // Finish
+            if ('\"' == c)
+                return true;
+
+            // Control characters must be escaped
+            if ('\\' != c)
+            {
+                --pos;
+                error = JEUnexpectedChar;
+                return false;
+            }
+
+            const char* next = Utils::unescapeChar(buf + pos, buf + bufSize, s);
+            if (nullptr == next)
+            {
+                error = eof() ? JEUnexpectedEnd : JEUnexpectedChar;
+                return false;
+            }
+            pos = static_cast<size_t>(next - buf);
+
+        } while (true);
+    }
+
+    // Same as above. In in-situ mode s refers to the buffer instead of owning
+    // a copy; only strings with escapes are written to, their decoded text is
+    // moved back over the source (it is never longer than its escaped form).
+    bool readString(StringData& s)
+    {
+        if (nullptr == insitu)
+        {
+            std::string s2;
+            if (!readString(s2))
+                return false;
+            s = StringData(std::move(s2));
+            return true;
+        }
+
+        char c = readNext();
+        if (c != '\"')
+        {
+            error = JEMismatchValueType;
+            return false;
+        }
+
+        const size_t first = pos;
+        size_t w = pos;
+        do {
+
+            const size_t start = pos;
+            pos = scanString(pos);
+            if (w != start)
+                memmove(insitu + w, insitu + start, pos - start);
+            w += pos - start;
+
+            if (eof())
+            {
+                error = JEUnexpectedEnd;
+                return false;
+            }
+
+            c = readNext();
+
+            // Finish
+            if ('\"' == c)
+            {
+                s = StringData::borrow(insitu + first, w - first);
+                return true;
+            }
+
+            // Control characters must be escaped
+            if ('\\' != c)
+            {
+                --pos;
+                error = JEUnexpectedChar;
+                return false;
+            }
+
+            char u[4];
+            size_t n = 0;
+            const char* next = Utils::decodeEscape(buf + pos, buf + bufSize, u, n);
+            if (nullptr == next)
+            {
+                error = eof() ? JEUnexpectedEnd : JEUnexpectedChar;
+                return false;
+            }
+            memcpy(insitu + w, u, n);
+            w += n;
+            pos = static_cast<size_t>(next - buf);
+
+        } while (true);
+    }
+
+    // Zero-copy read: s points into the buffer if there is nothing to decode.
+    // Otherwise it points to the decoded text, which lives in the buffer in
+    // in-situ mode and in a scratch string (valid until the next call) else.
+    bool readStringView(const char*& s, size_t& n)
+    {
+        if (insitu)
+        {
+            StringData sd;
+            if (!readString(sd))
+                return false;
+            s = sd.data();
+            n = sd.size();
+            return true;
+        }
+
+        const size_t start = pos;
+        if (readNext() == '\"')
+        {
+            const size_t end = scanString(pos);
+            if (end < bufSize && buf[end] == '\"')
+            {
+                s = buf + pos;
+                n = end - pos;
+                pos = end + 1;
+                return true;
+            }
+        }
+
+        pos = start;
+        scratch.clear();
+        if (!readString(scratch))
+            return false;
+        s = scratch.data();
+        n = scratch.size();
+        return true;
+    }
+
+    // Object keys come from the string pool if there is one
+    bool readKey(StringData& key)
+    {
+        if (nullptr == pool)
+            return arena ? readArenaString(key) : readString(key);
+
+        const char* s = nullptr;
+        size_t n = 0;
+        if (!readStringView(s, n))
+            return false;
+        key = StringData::borrow(pool->intern(s, n), n);
+        return true;
+    }
+
+    IMPLEMENT::ValueString* readValueString()
+    {
+        StringData s;
+        if (nullptr != pool && 0 != internLength)
+        {
+            // Short values are pooled too
+            const char* p = nullptr;
+            size_t n = 0;
+            if (!readStringView(p, n))
+                return nullptr;
+            if (n <= internLength)
+                s = StringData::borrow(pool->intern(p, n), n);
+            else if (insitu)
+                s = StringData::borrow(p, n);
+            else
+                s = StringData(std::string(p, n));
+            return IMPLEMENT::ValueString::create(std::move(s));
+        }
+        if (arena)
+            return readArenaString(s) ? IMPLEMENT::ValueString::create(std::move(s)) : nullptr;
+        return readString(s) ? IMPLEMENT::ValueString::create(std::move(s)) : nullptr;
+    }
+
+    // Decoded text copied into the arena, in situ it stays in the buffer
+    bool readArenaString(StringData& s)
+    {
+        if (insitu)
+            return readString(s);
+        const char* p = nullptr;
+        size_t n = 0;
+        if (!readStringView(p, n))
+            return false;
+        s = StringData::borrow(arena->copy(p, n), n);
+        return true;
+    }
+
+    IMPLEMENT::ValueObject* readValueObject()
+    {
+        IMPLEMENT::ValueObject* pObject = IMPLEMENT::ValueObject::create();
+        if(nullptr == pObject)
+        {
+            error = JEBadAlloc;
+            return nullptr;
+        }
+
+        if (!readMembers(pObject))
+        {
+            delete pObject;
+            pObject = nullptr;
+        }
+
+        return pObject;
+    }
+
+    bool readMembers(IMPLEMENT::ValueObject* pObject)
+    {
+        char c = readNext();
+        if (c != '{')
+        {
+            error = JEMismatchValueType;
+            return false;
+        }
+
+        do {
+
+            c = peekNextNotSpace();
+            if (eof())
+            {
+                error = JEUnexpectedEnd;
+                break;
+            }
+
+            // Done
+            if (c == '}')
+            {
+                readNext();
+                buildObject(pObject);
+                break;
+            }
+
+            if (c == ',')
+            {
+                readNext();
+                continue;
+            }
+
+            if('\"' != c)
+            {
+                error = JEUnexpectedChar;
+                break;
+            }
+
+            // Read key
+            StringData key;
+            if (!readKey(key))
+                break;
+
+            // Read colon
+            c = peekNextNotSpace();
+            if (failed())
+                break;
+            if (c != ':')
+            {
+                error = JEMissingColon;
+                break;
+            }
+            // Skip it
+            readNext();
+
+            // Read Value
+            IMPLEMENT::ValueBase* value = readValue();
+            if (failed() || value == nullptr)
+                break;
+
+            // Insert new child item
+            pObject->append(std::move(key), adopt(value));
+
+        } while (true);
+
+        return !failed();
+    }
+
+    IMPLEMENT::ValueArray* readValueArray()
+    {
+        IMPLEMENT::ValueArray* pArray = IMPLEMENT::ValueArray::create();
+        if (nullptr == pArray)
+        {
+            error = JEBadAlloc;
+            return nullptr;
+        }
+
+        if (!readElements(pArray))
+        {
+            delete pArray;
+            pArray = nullptr;
+        }
+
+        return pArray;
+    }
+
+    bool readElements(IMPLEMENT::ValueArray* pArray)
+    {
+        char c = readNext();
+        if (c != '[')
+        {
+            error = JEMismatchValueType;
+            return false;
+        }
+
+        do {
+
+            c = peekNextNotSpace();
+            if (eof())
+            {
+                error = JEUnexpectedEnd;
+                break;
+            }
+
+            // Done
+            if (c == ']')
+            {
+                readNext();
+                break;
+            }
+
+            if (c == ',')
+            {
+                readNext();
+                continue;
+            }
+
+            // Read Value
+            IMPLEMENT::ValueBase* value = readValue();
+            if (failed() || value == nullptr)
+                break;
+
+            // Insert new child item
+            pArray->push_back(adopt(value));
+
+        } while (true);
+
+        return !failed();
+    }
+
+    // Validate an object/array and keep its text to be read later
+    IMPLEMENT::ValueBase* readLazyContainer(bool object)
+    {
+        const size_t start = pos;
+        if (!skipValue())
+            return nullptr;
+        if (object)
+            return IMPLEMENT::ValueObject::createLazy(buf + start, pos - start, lazyOwner, lazyConfig);
+        return IMPLEMENT::ValueArray::createLazy(buf + start, pos - start, lazyOwner, lazyConfig);
+    }
+
+    inline void setObjectLevel(uint64_t* local, size_t depth, bool object)
+    {
+        uint64_t* w = nullptr;
+        if (depth < 256)
+        {
+            w = local + depth / 64;
+        }
+        else
+        {
+            const size_t i = (depth - 256) / 64;
+            if (nesting.size() <= i)
+                nesting.resize(i + 1, 0);
+            w = &nesting[i];
+        }
+        const uint64_t bit = 1ULL << (depth % 64);
+        *w = object ? (*w | bit) : (*w & ~bit);
+    }
+
+    inline bool isObjectLevel(const uint64_t* local, size_t depth) const
+    {
+        const uint64_t w = (depth < 256) ? local[depth / 64] : nesting[(depth - 256) / 64];
+        return 0 != (w & (1ULL << (depth % 64)));
+    }
+
+    // Find the end of a string, escapes are checked but not decoded
+    bool skipString(bool utf8)
+    {
+        readNext();
+        do {
+
+            const size_t start = pos;
+            pos = scanString(pos);
+            if (utf8 && !Utils::validUtf8(buf + start, pos - start))
+            {
+                error = JEInvalidUtf8;
+                return false;
+            }
+
+            if (eof())
+            {
+                error = JEUnexpectedEnd;
+                return false;
+            }
+
+            const char c = readNext();
+
+            // Finish
+            if ('\"' == c)
+                return true;
+
+            // Control characters must be escaped
+            if ('\\' != c)
+            {
+                --pos;
+                error = JEUnexpectedChar;
+                return false;
+            }
+
+            char u[4];
+            size_t n = 0;
+            const char* next = Utils::decodeEscape(buf + pos, buf + bufSize, u, n);
+            if (nullptr == next)
+            {
+                error = eof() ? JEUnexpectedEnd : JEUnexpectedChar;
+                return false;
+            }
+            pos = static_cast<size_t>(next - buf);
+
+        } while (true);
+    }
+
+    // Check the syntax of a number without converting it. Only numbers with
+    // an exponent or a very long integer part can be out of range, those are
+    // converted to find out.
+    bool skipNumber()
+    {
+        const char* p = buf + pos;
+        const char* end = buf + bufSize;
+        if (p < end && *p == '-')
+            ++p;
+        if (p >= end)
+        {
+            error = JEUnexpectedEnd;
+            return false;
+        }
+        if (*p < '0' || *p > '9')
+        {
+            error = JEUnexpectedChar;
+            return false;
+        }
+
+        const char* digits = p;
+        if (*p == '0')
+        {
+            ++p;
+            if (p < end && *p >= '0' && *p <= '9')
+            {
+                error = JEUnexpectedChar;
+                return false;
+            }
+        }
+        else
+        {
+            while (p < end && *p >= '0' && *p <= '9')
+                ++p;
+        }
+        bool convert = (p - digits > 300);
+
+        if (p < end && *p == '.')
+        {
+            const char* frac = ++p;
+            while (p < end && *p >= '0' && *p <= '9')
+                ++p;
+            if (p == frac)
+            {
+                error = (p >= end) ? JEUnexpectedEnd : JEUnexpectedChar;
+                return false;
+            }
+        }
+
+        if (p < end && (*p == 'e' || *p == 'E'))
+            convert = true;
+
+        if (convert)
+        {
+            NumberToken num;
+            return readNumber(num);
+        }
+
+        pos = static_cast<size_t>(p - buf);
+        return true;
+    }
+
+    IMPLEMENT::ValueObject* readProjectedObject(const Projection::Node& node)
+    {
+        std::unique_ptr<IMPLEMENT::ValueObject> pObject(IMPLEMENT::ValueObject::create());
+        readNext();
+
+        do {
+
+            char c = peekNextNotSpace();
+            if (eof())
+            {
+                error = JEUnexpectedEnd;
+                break;
+            }
+
+            // Done
+            if (c == '}')
+            {
+                readNext();
+                buildObject(pObject.get());
+                break;
+            }
+
+            if (c == ',')
+            {
+                readNext();
+                continue;
+            }
+
+            if ('\"' != c)
+            {
+                error = JEUnexpectedChar;
+                break;
+            }
+
+            // Read key, only kept if the member is selected
+            const char* key = nullptr;
+            size_t n = 0;
+            if (!readStringView(key, n))
+                break;
+            const Projection::Node* child = node.find(key, n);
+            StringData name;
+            if (nullptr != child)
+            {
+                if (nullptr != pool)
+                    name = StringData::borrow(pool->intern(key, n), n);
+                else if (insitu)
+                    name = StringData::borrow(key, n);
+                else if (arena)
+                    name = StringData::borrow(arena->copy(key, n), n);
+                else
+                    name = StringData(std::string(key, n));
+            }
+
+            // Read colon
+            c = peekNextNotSpace();
+            if (c != ':')
+            {
+                error = eof() ? JEUnexpectedEnd : JEMissingColon;
+                break;
+            }
+            // Skip it
+            readNext();
+
+            // Read Value
+            if (nullptr == child)
+            {
+                if (!skipValue())
+                    break;
+                continue;
+            }
+            IMPLEMENT::ValueBase* value = readValue(*child);
+            if (failed())
+                break;
+            if (nullptr != value)
+                pObject->append(std::move(name), adopt(value));
+
+        } while (true);
+
+        return failed() ? nullptr : pObject.release();
+    }
+
+    IMPLEMENT::ValueArray* readProjectedArray(const Projection::Node& node)
+    {
+        std::unique_ptr<IMPLEMENT::ValueArray> pArray(IMPLEMENT::ValueArray::create());
+        readNext();
+
+        size_t index = 0;
+        do {
+
+            const char c = peekNextNotSpace();
+            if (eof())
+            {
+                error = JEUnexpectedEnd;
+                break;
+            }
+
+            // Done
+            if (c == ']')
+            {
+                readNext();
+                break;
+            }
+
+            if (c == ',')
+            {
+                readNext();
+                continue;
+            }
+
+            // Elements are selected by index or "*"
+            const Projection::Node* child = nullptr;
+            if (node.hasNamed())
+            {
+                char s[24];
+                const int n = snprintf(s, sizeof(s), "%zu", index);
+                child = node.find(s, static_cast<size_t>(n));
+            }
+            else
+            {
+                child = node.find(nullptr, 0);
+            }
+            ++index;
+
+            // Read Value
+            if (nullptr == child)
+            {
+                if (!skipValue())
+                    break;
+                continue;
+            }
+            IMPLEMENT::ValueBase* value = readValue(*child);
+            if (failed())
+                break;
+            if (nullptr != value)
+                pArray->push_back(adopt(value));
+
+        } while (true);
+
+        return failed() ? nullptr : pArray.release();
+    }
+
+    inline void setError(JsonError e)
+    {
+        error = e;
+    }
+
+    inline bool notify(bool ok)
+    {
+        if (!ok)
+            error = JEAborted;
+        return ok;
+    }
+
+    template<typename Handler>
+    bool readScalar(Handler& handler)
+    {
+        switch (checkValueType())
+        {
+        case JsonNull:
+            return readNull() && notify(handler.null());
+        case JsonBoolean:
+        {
+            bool v = false;
+            return readBoolean(v) && notify(handler.boolean(v));
+        }
+        case JsonNumber:
+        {
+            NumberToken num;
+            if (!readNumber(num))
+                return false;
+            switch (num.type)
+            {
+            case NumberToken::Int64:
+                return notify(handler.int64(num.i));
+            case NumberToken::Uint64:
+                return notify(handler.uint64(num.u));
+            default:
+                break;
+            }
+            return notify(handler.decimal(num.d));
+        }
+        case JsonString:
+        {
+            const char* s = nullptr;
+            size_t n = 0;
+            return readStringView(s, n) && notify(handler.string(s, n));
+        }
+        default:
+            break;
+        }
+
+        error = JEUnexpectedChar;
+        return false;
+    }
+
+    // A container read in a loop: the open containers are kept in frames,
+    // not on the call stack. Each value is added to its parent right away,
+    // so on failure deleting the root frees everything.
+    IMPLEMENT::ValueBase* readContainer()
+    {
+        const size_t base = frames.size();
+        IMPLEMENT::ValueBase* root = nullptr;
+        try
+        {
+            if (readContainer(base, root))
+                return root;
+        }
+        catch (...)
+        {
+            // e.g. bad_alloc, the nodes read so far are freed the same way
+            frames.resize(base, Frame(nullptr, false));
+            delete root;
+            throw;
+        }
+        frames.resize(base, Frame(nullptr, false));
+        delete root;
+        return nullptr;
+    }
+
+    // Fills root, false on failure
+    bool readContainer(size_t base, IMPLEMENT::ValueBase*& root)
+    {
+        StringData key;
+        char c = peekNextNotSpace();
+
+        do {
+
+            const bool container = (c == '{' || c == '[');
+            IMPLEMENT::ValueBase* value = nullptr;
+            if (container)
+            {
+                if (!checkDepth(frames.size() - base))
+                    break;
+                readNext();
+                value = ('{' == c)
+                    ? static_cast<IMPLEMENT::ValueBase*>(IMPLEMENT::ValueObject::create())
+                    : static_cast<IMPLEMENT::ValueBase*>(IMPLEMENT::ValueArray::create());
+            }
+            else
+            {
+                value = readValue();
+                if (nullptr == value)
+                    break;
+            }
+
+            if (frames.size() == base)
+                root = value;
+            else if (frames.back().object)
+                static_cast<IMPLEMENT::ValueObject*>(frames.back().container)->append(std::move(key), adopt(value));
+            else
+                static_cast<IMPLEMENT::ValueArray*>(frames.back().container)->append(adopt(value));
+            if (container)
+                frames.push_back(Frame(value, '{' == c));
+
+            // Move to the next value, closing the containers which end
+            bool ok = true;
+            while (frames.size() > base)
+            {
+                c = peekNextNotSpace();
+                if (eof())
+                {
+                    error = JEUnexpectedEnd;
+                    ok = false;
+                    break;
+                }
+
+                const bool object = frames.back().object;
+                if (c == (object ? '}' : ']'))
+                {
+                    readNext();
+                    if (object && !buildObject(static_cast<IMPLEMENT::ValueObject*>(frames.back().container)))
+                    {
+                        ok = false;
+                        break;
+                    }
+                    frames.pop_back();
+                    // A complete object of an array goes into its columns
+                    if (object && columnar && frames.size() > base && !frames.back().object)
+                        static_cast<IMPLEMENT::ValueArray*>(frames.back().container)->absorbLast();
+                    continue;
+                }
+
+                if (c == ',')
+                {
+                    readNext();
+                    continue;
+                }
+
+                if (object)
+                {
+                    if ('\"' != c)
+                    {
+                        error = JEUnexpectedChar;
+                        ok = false;
+                        break;
+                    }
+
+                    // Read key
+                    if (!readKey(key))
+                    {
+                        ok = false;
+                        break;
+                    }
+
+                    // Read colon
+                    c = peekNextNotSpace();
+                    if (c != ':')
+                    {
+                        error = eof() ? JEUnexpectedEnd : JEMissingColon;
+                        ok = false;
+                        break;
+                    }
+                    readNext();
+                    c = peekNextNotSpace();
+                }
+                break;
+            }
+
+            if (!ok)
+                break;
+            if (frames.size() == base)
+                return true;
+
+        } while (true);
+
+        return false;
+    }
+
+    struct Frame
+    {
+        Frame(IMPLEMENT::ValueBase* p, bool o) : container(p), object(o) {}
+        IMPLEMENT::ValueBase* container;
+        bool object;
+    };
+
+    struct Level
+    {
+        explicit Level(bool o) : object(o), count(0) {}
+        bool object;
+        size_t count;
+    };
+
+private:
+    std::istream* stm;
+    std::string streamBuf;
+    const char* buf;
+    size_t bufSize;
+    char* insitu;
+    size_t pos;
+    JsonError error;
+    StructuralIndex index;
+    bool indexed;
+    size_t idxPos;
+    bool lazy;
+    std::shared_ptr<void> lazyOwner;
+    std::shared_ptr<const ParseConfig> lazyConfig;
+    // Decoded strings handed out by readStringView()
+    std::string scratch;
+    // Nesting levels of skipValue() beyond the first 256
+    std::vector<uint64_t> nesting;
+    size_t maxDepth;
+    DuplicateKeyPolicy duplicateKeys;
+    StringPool* pool;
+    size_t internLength;
+    bool columnar;
+    bool rawNumbers;
+    bool arenaEnabled;
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    std::pmr::memory_resource* resource;
+#endif
+    // Arena of the document being read
+    std::shared_ptr<IMPLEMENT::Arena> arena;
+    // Open containers of readContainer() and readValue(Handler&)
+    std::vector<Frame> frames;
+    std::vector<Level> levels;
+};
+
+template<typename T>
+class StringParser : public Parser
+{
+public:
+    StringParser(const std::basic_string<T>& s)
+        : Parser(), str(Utils::toUtf8(s))
+    {
+        assign(str.data(), str.size());
+    }
+    virtual ~StringParser()
+    {
+    }
+
+    virtual void reset(const std::basic_string<T>& s)
+    {
+        str = Utils::toUtf8(s);
+        assign(str.data(), str.size());
+    }
+
+private:
+    std::string str;
+};
+
+// Destructive parser: the buffer is modified and has to outlive the parsed
+// values, which refer to it. It can't be parsed twice, so reset() only
+// rewinds the position.
+class InSituParser : public Parser
+{
+public:
+    InSituParser(char* s, size_t n, const ParseConfig* config = nullptr)
+        : Parser()
+    {
+        assignInSitu(s, n);
+        configure(config);
+    }
+    virtual ~InSituParser()
+    {
+    }
+};
+
+inline void ValueObject::expand() const
+{
+    std::lock_guard<std::mutex> lock(source->mutex);
+    if (source->loaded.load(std::memory_order_relaxed))
+        return;
+    // Read into a loaded object, inserting the members must not expand again.
+    // The text was validated with the document. The member vector is
+    // allocated like this one, not from the arena of the members.
+    ValueObject loaded(keepOrder, vals.get_allocator());
+    Parser parser(source->text, source->size, source->config.get());
+    parser.setLazy(source->owner, source->config);
+    parser.expand(&loaded, source->nodes);
+    vals.swap(loaded.vals);
+    source->owner.reset();
+    source->loaded.store(true, std::memory_order_release);
+}
+
+inline void ValueArray::expand() const
+{
+    std::lock_guard<std::mutex> lock(source->mutex);
+    if (source->loaded.load(std::memory_order_relaxed))
+        return;
+    ValueArray loaded(vals.get_allocator());
+    Parser parser(source->text, source->size, source->config.get());
+    parser.setLazy(source->owner, source->config);
+    parser.expand(&loaded, source->nodes);
+    vals.swap(loaded.vals);
+    source->owner.reset();
+    source->loaded.store(true, std::memory_order_release);
+}
+
+// Parses the elements of a large top-level array on worker threads. The
+// calling thread finds the element boundaries and hands them out in batches,
+// so scanning and parsing overlap; the results are stitched in order.
+class ParallelArrayParser
+{
+public:
+    // Returns nullptr if s is not an array or one of its elements fails. With
+    // insitu (== s) the elements are parsed in place. With an arena, each
+    // batch is read into one of its own. An exception of a worker is thrown
+    // again on the calling thread.
+    static std::shared_ptr<ValueBase> parse(const char* s, size_t n, char* insitu, const ParseConfig* config, size_t threads)
+    {
+        // The elements are one level below the root, with a limit of 1 they
+        // may only be scalars: left to the serial parser
+        const size_t maxDepth = config ? config->getMaxDepth() : static_cast<size_t>(ParseConfig::DefaultMaxDepth);
+        if (1 == maxDepth)
+            return nullptr;
+        ParseConfig elementConfig(config ? *config : ParseConfig());
+        elementConfig.setThreads(1);
+        if (0 != maxDepth)
+            elementConfig.setMaxDepth(maxDepth - 1);
+
+        std::deque<Batch> batches;
+        std::mutex m;
+        std::condition_variable cv;
+        size_t nextBatch = 0;
+        bool scanned = false;
+        bool failed = false;
+        std::exception_ptr error;
+
+        auto worker = [&]() {
+            for (;;)
+            {
+                Batch* batch = nullptr;
+                {
+                    std::unique_lock<std::mutex> lock(m);
+                    cv.wait(lock, [&]() -> bool { return failed || scanned || nextBatch < batches.size(); });
+                    if (failed || nextBatch == batches.size())
+                        break;
+                    batch = &batches[nextBatch++];
+                }
+                bool ok = false;
+                std::exception_ptr e;
+                try
+                {
+                    ok = parseBatch(s, insitu, &elementConfig, *batch);
+                }
+                catch (...)
+                {
+                    e = std::current_exception();
+                }
+                if (!ok)
+                {
+                    std::lock_guard<std::mutex> lock(m);
+                    if (e && !error)
+                        error = e;
+                    failed = true;
+                    cv.notify_all();
+                    break;
+                }
+            }
+        };
+
+        std::vector<std::thread> pool;
+        try
+        {
+            for (size_t i = 0; i < threads; ++i)
+                pool.push_back(std::thread(worker));
+
+            Batch batch;
+            size_t batchBytes = 0;
+            size_t count = 0;
+            const bool closed = StructuralIndex::splitArray(s, n, [&](size_t begin, size_t end) {
+                batch.ranges.push_back(std::make_pair(begin, end));
+                batchBytes += end - begin;
+                ++count;
+                if (batchBytes >= 262144 || batch.ranges.size() >= 4096)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(m);
+                        batches.push_back(Batch());
+                        batches.back().ranges.swap(batch.ranges);
+                    }
+                    cv.notify_one();
+                    batchBytes = 0;
+                }
+            });
+
+            {
+                std::lock_guard<std::mutex> lock(m);
+                if (!batch.ranges.empty())
+                {
+                    batches.push_back(Batch());
+                    batches.back().ranges.swap(batch.ranges);
+                }
+                scanned = true;
+                if (!closed)
+                    failed = true;
+            }
+            cv.notify_all();
+            for (size_t i = 0; i < pool.size(); ++i)
+                pool[i].join();
+
+            if (error)
+                std::rethrow_exception(error);
+            if (failed)
+                return nullptr;
+
+            const std::shared_ptr<Arena> arena = Parser::createArena(config, 256 + count * sizeof(std::shared_ptr<ValueBase>));
+            Arena::Scope scope(arena.get());
+            ValueArray* pArray = ValueArray::create();
+            if (nullptr == pArray)
+                return nullptr;
+            std::shared_ptr<ValueBase> sp = Parser::adopt(pArray, arena);
+            pArray->reserve(count);
+            for (size_t i = 0; i < batches.size(); ++i)
+            {
+                for (size_t j = 0; j < batches[i].values.size(); ++j)
+                    pArray->push_back(batches[i].values[j]);
+            }
+            return sp;
+        }
+        catch (...)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m);
+                failed = true;
+            }
+            cv.notify_all();
+            for (size_t i = 0; i < pool.size(); ++i)
+            {
+                if (pool[i].joinable())
+                    pool[i].join();
+            }
+            throw;
+        }
+    }
+
+private:
+    struct Batch
+    {
+        std::vector<std::pair<size_t, size_t>> ranges;
+        std::vector<std::shared_ptr<ValueBase>> values;
+    };
+
+    static bool parseBatch(const char* s, char* insitu, const ParseConfig* config, Batch& batch)
+    {
+        batch.values.reserve(batch.ranges.size());
+        // Only this thread fills it
+        const std::shared_ptr<Arena> arena = Parser::createArena(config);
+        for (size_t i = 0; i < batch.ranges.size(); ++i)
+        {
+            const size_t begin = batch.ranges[i].first;
+            const size_t n = batch.ranges[i].second - begin;
+            std::shared_ptr<ValueBase> sp;
+            size_t used = 0;
+            if (insitu)
+            {
+                InSituParser parser(insitu + begin, n, config);
+                sp = parser.readShared(arena);
+                used = parser.getPos();
+            }
+            else
+            {
+                Parser parser(s + begin, n, config);
+                sp = parser.readShared(arena);
+                used = parser.getPos();
+            }
+            if (!sp)
+                return false;
+            batch.values.push_back(sp);
+
+            // Nothing but whitespace may follow the value
+            for (; used < n; ++used)
+            {
+                const char c = s[begin + used];
+                if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+                    return false;
+            }
+        }
+        return true;
+    }
+};
+
+class ValueFactory
+{
+public:
+    static IMPLEMENT::ValueBase* create(ValueType type)
+    {
+        switch (type)
+        {
+        case JsonNull:
+            return IMPLEMENT::ValueNull::create();
+        case JsonBoolean:
+            return IMPLEMENT::ValueBoolean::create(false);
+        case JsonNumber:
+            return IMPLEMENT::ValueNumber::create(static_cast<int64_t>(0));
+        case JsonString:
+            return IMPLEMENT::ValueString::create("", false);
+        case JsonObject:
+            return IMPLEMENT::ValueObject::create(true);
+        case JsonArray:
+            return IMPLEMENT::ValueArray::create();
+        default:
+            break;
+        }
+        return nullptr;
+    }
+
+    static IMPLEMENT::ValueNull* createNull()
+    {
+        return IMPLEMENT::ValueNull::create();
+    }
+
+    static IMPLEMENT::ValueBoolean* createBoolean(bool v)
+    {
+        return IMPLEMENT::ValueBoolean::create(v);
+    }
+
+    static IMPLEMENT::ValueString* createString(const std::string& s, bool escaped)
+    {
+        return IMPLEMENT::ValueString::create(s, escaped);
+    }
+
+    static IMPLEMENT::ValueString* createString(const std::wstring& s, bool escaped)
+    {
+        return IMPLEMENT::ValueString::create(s, escaped);
+    }
+
+    static IMPLEMENT::ValueObject* createObject(bool keepOrder)
+    {
+        return IMPLEMENT::ValueObject::create(keepOrder);
+    }
+
+    static IMPLEMENT::ValueArray* createArray()
+    {
+        return IMPLEMENT::ValueArray::create();
+    }
+
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    // Same as above from resource: the node and its reference count, the
+    // members of an object/array, the text of a string, and the values which
+    // set()/push_back() create in the containers. nullptr: the heap.
+    static std::shared_ptr<IMPLEMENT::ValueBase> create(ValueType type, std::pmr::memory_resource* resource)
+    {
+        switch (type)
+        {
+        case JsonNull:
+            return IMPLEMENT::ValueNull::create(resource);
+        case JsonBoolean:
+            return IMPLEMENT::ValueBoolean::create(false, resource);
+        case JsonNumber:
+            return IMPLEMENT::ValueNumber::create(static_cast<int64_t>(0), resource);
+        case JsonString:
+            return IMPLEMENT::ValueString::create("", false, resource);
+        case JsonObject:
+            return IMPLEMENT::ValueObject::create(true, resource);
+        case JsonArray:
+            return IMPLEMENT::ValueArray::create(resource);
+        default:
+            break;
+        }
+        return std::shared_ptr<IMPLEMENT::ValueBase>();
+    }
+
+    static std::shared_ptr<IMPLEMENT::ValueNull> createNull(std::pmr::memory_resource* resource)
+    {
+        return IMPLEMENT::ValueNull::create(resource);
+    }
+
+    static std::shared_ptr<IMPLEMENT::ValueBoolean> createBoolean(bool v, std::pmr::memory_resource* resource)
+    {
+        return IMPLEMENT::ValueBoolean::create(v, resource);
+    }
+
+    static std::shared_ptr<IMPLEMENT::ValueString> createString(const std::string& s, bool escaped, std::pmr::memory_resource* resource)
+    {
+        return IMPLEMENT::ValueString::create(s, escaped, resource);
+    }
+
+    static std::shared_ptr<IMPLEMENT::ValueString> createString(const std::wstring& s, bool escaped, std::pmr::memory_resource* resource)
+    {
+        return IMPLEMENT::ValueString::create(s, escaped, resource);
+    }
+
+    static std::shared_ptr<IMPLEMENT::ValueObject> createObject(bool keepOrder, std::pmr::memory_resource* resource)
+    {
+        return IMPLEMENT::ValueObject::create(keepOrder, resource);
+    }
+
+    static std::shared_ptr<IMPLEMENT::ValueArray> createArray(std::pmr::memory_resource* resource)
+    {
+        return IMPLEMENT::ValueArray::create(resource);
+    }
+#endif
+};
+
+}   // namespace IMPLEMENT
+
+class Value
+{
+public:
+    Value() : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueNull::create())) {}
+    Value(const Value& rhs) : vp(rhs.vp), doc(rhs.doc) {}
+    explicit Value(bool v) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueBoolean::create(v))) {}
+    explicit Value(int32_t v) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueNumber::create(v))) {}
+    explicit Value(int64_t v) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueNumber::create(v))) {}
+    explicit Value(uint32_t v) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueNumber::create(v))) {}
+    explicit Value(uint64_t v) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueNumber::create(v))) {}
+    explicit Value(float_t v) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueNumber::create(v))) {}
+    explicit Value(double_t v) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueNumber::create(v))) {}
+    explicit Value(const std::string& v, bool escaped=false) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueString::create(v, escaped))) {}
+    explicit Value(const std::wstring& v, bool escaped=false) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueString::create(v, escaped))) {}
+    explicit Value(std::shared_ptr<IMPLEMENT::ValueBase> p) : vp(p) {}
+    explicit Value(ValueType vt)
+        : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueFactory::create(vt)))
+    {
+    }
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    // Allocated from resource, and so are the values set()/push_back() add
+    // to an object or array (see ValueFactory)
+    Value(ValueType vt, std::pmr::memory_resource* resource)
+        : vp(IMPLEMENT::ValueFactory::create(vt, resource))
+    {
+    }
+#endif
+    virtual ~Value() {}
+
+    Value& operator = (const Value& rhs)
+    {
+        if (this != &rhs)
+        {
+            vp = rhs.vp;
+            doc = rhs.doc;
+        }
+        return *this;
+    }
+
+    static Value parse(const char* s, size_t n, const ParseConfig* config = nullptr)
+    {
+        // The lazy document keeps a copy of the input
+        if (nullptr != config && config->useLazy())
+        {
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+            if (nullptr != config->getMemoryResource())
+            {
+                std::pmr::polymorphic_allocator<char> alloc(config->getMemoryResource());
+                std::shared_ptr<std::pmr::string> text = std::allocate_shared<std::pmr::string>(alloc, s, n);
+                return parseLazy(text->data(), text->size(), text, config);
+            }
+#endif
+            std::shared_ptr<std::string> text(new std::string(s, n));
+            return parseLazy(text->data(), text->size(), text, config);
+        }
+
+        const size_t threads = parallelThreads(s, n, config);
+        if (threads > 1)
+        {
+            // Falls back to the serial parser, which also reports the error
+            std::shared_ptr<IMPLEMENT::ValueBase> p = IMPLEMENT::ParallelArrayParser::parse(s, n, nullptr, config, threads);
+            if (p)
+                return Value(p);
+        }
+
+        IMPLEMENT::Parser parser(s, n, config);
+        return Value(parser.readRoot());
+    }
+
+    static Value parse(const std::string& s, const ParseConfig* config = nullptr)
+    {
+        return parse(s.data(), s.size(), config);
+    }
+
+    static Value parse(const std::wstring& s, const ParseConfig* config = nullptr)
+    {
+        const std::string& s2 = Utils::toUtf8(s);
+        return parse(s2.data(), s2.size(), config);
+    }
+
+    // Only the paths selected by projection are built, e.g.
+    // Value::parse(s, {"/user/id", "/events/*/ts"}). Objects and arrays on a
+    // selected path keep just the selected members; array elements which are
+    // left out shift the indexes of the following ones.
+    static Value parse(const char* s, size_t n, const Projection& projection, const ParseConfig* config = nullptr)
+    {
+        IMPLEMENT::Parser parser(s, n, config);
+        std::shared_ptr<IMPLEMENT::ValueBase> p = parser.readRoot(projection.getRoot());
+        if (parser.failed())
+            return Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        // Nothing selected
+        if (!p)
+            return Value();
+        return Value(p);
+    }
+
+    static Value parse(const std::string& s, const Projection& projection, const ParseConfig* config = nullptr)
+    {
+        return parse(s.data(), s.size(), projection, config);
+    }
+
+    // In-situ parsing: strings and keys are decoded in place inside s and the
+    // values refer to that memory instead of owning copies. s is modified and
+    // must outlive the result.
+    static Value parseInSitu(char* s, size_t n, const ParseConfig* config = nullptr)
+    {
+        // Lazy containers must see the original text, so nothing is decoded
+        // in place
+        if (nullptr != config && config->useLazy())
+            return parseLazy(s, n, std::shared_ptr<void>(), config);
+
+        const size_t threads = parallelThreads(s, n, config);
+        if (threads > 1)
+        {
+            // The buffer may have been modified, no fallback
+            return Value(IMPLEMENT::ParallelArrayParser::parse(s, n, s, config, threads));
+        }
+
+        IMPLEMENT::InSituParser parser(s, n, config);
+        return Value(parser.readRoot());
+    }
+
+    // Same as above, the document takes over s and keeps it alive
+    static Value parseInSitu(std::string&& s, const ParseConfig* config = nullptr)
+    {
+        std::shared_ptr<std::string> holder(new std::string(std::move(s)));
+        Value v(parseInSitu(&(*holder)[0], holder->size(), config));
+        v.doc = holder;
+        return v;
+    }
+
+    static Value parseFile(const std::string& file, const ParseConfig* config = nullptr)
+    {
+        if (nullptr == config || config->useFileMapping())
+        {
+            std::shared_ptr<IMPLEMENT::MappedFile> mf(new IMPLEMENT::MappedFile());
+            if (mf->open(file, nullptr != config && config->usePopulate()))
+            {
+                if (config && config->useLazy())
+                    return parseLazy(mf->data(), mf->size(), mf, config);
+                Value v(parseInSitu(mf->data(), mf->size(), config));
+                v.doc = mf;
+                return v;
+            }
+            // Not mappable (e.g. a pipe), read it instead
+        }
+
+        std::ifstream ifs;
+        ifs.open(file, std::ifstream::in | std::ifstream::binary);
+        if (!ifs.is_open())
+            return Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        IMPLEMENT::Parser parser(ifs, config);
+        return Value(parser.readRoot());
+    }
+
+    inline bool valid() const { return (nullptr != vp); }
+    inline std::string serialize(SerializeConfig* config = nullptr) const { return vp->serialize(config); }
+    inline size_t size() const { return valid() ? vp->size() : 0; }
+
+    inline bool isNull() const { return valid() && vp->isNull(); }
+    inline bool isBoolean() const { return valid() && vp->isBoolean(); }
+    inline bool isNumber() const { return valid() && vp->isNumber(); }
+    inline bool isString() const { return valid() && vp->isString(); }
+    inline bool isObject() const { return valid() && vp->isObject(); }
+    inline bool isArray() const { return valid() && vp->isArray(); }
+
+    inline bool getBoolean() const { return (isBoolean() && dynamic_cast<IMPLEMENT::ValueBoolean*>(vp.get())->get()); }
+    inline void set(bool v) { if (isBoolean()) dynamic_cast<IMPLEMENT::ValueBoolean*>(vp.get())->set(v); }
+
+    inline bool isSignedNumber() const { return (isNumber() && dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->isSigned()); }
+    inline bool isIntegerNumber() const { return (isNumber() && dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->isInteger()); }
+    inline bool isDecimalNumber() const { return (isNumber() && dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->isDecimal()); }
+    inline int32_t getInt32() const
+    {
+        return isNumber() ? dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->toInt32() : 0;
+    }
+    inline int64_t getInt64() const
+    {
+        return isNumber() ? dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->toInt64() : 0;
+    }
+    inline uint32_t getUint32() const
+    {
+        return isNumber() ? dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->toUint32() : 0;
+    }
+    inline uint64_t getUint64() const
+    {
+        return isNumber() ? dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->toUint64() : 0;
+    }
+    inline double_t getDecimal() const
+    {
+        return isNumber() ? dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->toDecimal() : 0.0;
+    }
+
+    inline void set(int32_t v) { if (isNumber()) dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->set(v); }
+    inline void set(int64_t v) { if (isNumber()) dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->set(v); }
+    inline void set(uint32_t v) { if (isNumber()) dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->set(v); }
+    inline void set(uint64_t v) { if (isNumber()) dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->set(v); }
+    inline void set(float_t v) { if (isNumber()) dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->set(v); }
+    inline void set(double_t v) { if (isNumber()) dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->set(v); }
+
+    inline std::string getString() const
+    {
+        return isString() ? dynamic_cast<IMPLEMENT::ValueString*>(vp.get())->get() : std::string();
+    }
+    inline std::wstring getWstring() const
+    {
+        return isString() ? dynamic_cast<IMPLEMENT::ValueString*>(vp.get())->getw() : std::wstring();
+    }
+    inline void set(const std::string& v) { if (isString()) dynamic_cast<IMPLEMENT::ValueString*>(vp.get())->set(v, false); }
+    inline void set(const std::wstring& v) { if (isString()) dynamic_cast<IMPLEMENT::ValueString*>(vp.get())->set(v, false); }
+
+    Value operator [](const std::string& key)
+    {
+#ifdef _DEBUG
+        if (!isObject())
+            return Value();
+        else
+            return Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->get(key), doc);
+#else
+        return isObject() ?Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->get(key), doc) : Value();
+#endif
+    }
+
+    const Value operator [](const std::string& key) const
+    {
+#ifdef _DEBUG
+        if (!isObject())
+            return Value();
+        else
+            return Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->get(key), doc);
+#else
+        return isObject() ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->get(key), doc) : Value();
+#endif
+    }
+
+    Value set(const std::string& key, Value& v)
+    {
+        return isObject()
+            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v.getPtr()))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+    Value set(const std::string& key, bool v)
+    {
+        return isObject()
+            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+    Value set(const std::string& key, int32_t v)
+    {
+        return isObject()
+            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+    Value set(const std::string& key, uint32_t v)
+    {
+        return isObject()
+            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+    Value set(const std::string& key, int64_t v)
+    {
+        return isObject()
+            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+    Value set(const std::string& key, uint64_t v)
+    {
+        return isObject()
+            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+    Value set(const std::string& key, double_t v)
+    {
+        return isObject()
+            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+    Value set(const std::string& key, const std::string& v)
+    {
+        return isObject()
+            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+    Value set(const std::string& key, const std::wstring& v)
+    {
+        return isObject()
+            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+
+    // Non-const access may modify the element: a columnar array is converted
+    // to one object per element first
+    Value operator [](size_t id)
+    {
+#ifdef _DEBUG
+        if (!isArray())
+            return Value();
+        else
+            return Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->at(id), doc);
+#else
+        return isArray() ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->at(id), doc) : Value();
+#endif
+    }
+
+    const Value operator [](size_t id) const
+    {
+#ifdef _DEBUG
+        if (!isArray())
+            return Value();
+        else
+            return Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->get(id), doc);
+#else
+        return isArray() ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->get(id), doc) : Value();
+#endif
+    }
+
+    // Columns of a columnar array (ParseConfig::setColumnar()), nullptr if
+    // none. Valid until the array is modified.
+    const IMPLEMENT::ColumnTable* getColumns() const
+    {
+        return isArray() ? dynamic_cast<const IMPLEMENT::ValueArray*>(vp.get())->getColumns() : nullptr;
+    }
+
+    Value push_back(Value& v)
+    {
+        return isArray()
+            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v.getPtr()))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+    Value push_back(bool v)
+    {
+        return isArray()
+            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+    Value push_back(int32_t v)
+    {
+        return isArray()
+            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+    Value push_back(uint32_t v)
+    {
+        return isArray()
+            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+    Value push_back(int64_t v)
+    {
+        return isArray()
+            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+    Value push_back(uint64_t v)
+    {
+        return isArray()
+            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+    Value push_back(double_t v)
+    {
+        return isArray()
+            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+    Value push_back(const std::string& v)
+    {
+        return isArray()
+            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+    Value push_back(const std::wstring& v)
+    {
+        return isArray()
+            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v))
+            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+    }
+
+protected:
+    std::shared_ptr<IMPLEMENT::ValueBase> getPtr() { return vp; }
+
+private:
+    Value(std::shared_ptr<IMPLEMENT::ValueBase> p, std::shared_ptr<void> d) : vp(p), doc(d) {}
+
+    // owner keeps s alive for the lazy containers
+    static Value parseLazy(const char* s, size_t n, std::shared_ptr<void> owner, const ParseConfig* config)
+    {
+        IMPLEMENT::Parser parser(s, n, config);
+        // A duplicate key has to fail the parse, every object is read then
+        if (DuplicateError == config->getDuplicateKeys())
+            return Value(parser.readRoot());
+
+        // The containers are read later with the same settings
+        std::shared_ptr<ParseConfig> shared;
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+        if (nullptr != config->getMemoryResource())
+            shared = std::allocate_shared<ParseConfig>(std::pmr::polymorphic_allocator<ParseConfig>(config->getMemoryResource()), *config);
+#endif
+        if (!shared)
+            shared = std::make_shared<ParseConfig>(*config);
+        shared->setStructuralIndex(false);
+        shared->setThreads(1);
+        parser.setLazy(owner, shared);
+        return Value(parser.readRoot());
+    }
+
+    // Threads for the elements of a top-level array, 1 if it isn't worth it
+    // (with a depth limit of 1 the elements may only be scalars, see
+    // ParallelArrayParser::parse())
+    static size_t parallelThreads(const char* s, size_t n, const ParseConfig* config)
+    {
+        if (nullptr == config || 1 == config->getThreads() || 1 == config->getMaxDepth() || n < 1048576)
+            return 1;
+        size_t i = 0;
+        while (i < n && (s[i] == ' ' || s[i] == '\n' || s[i] == '\r' || s[i] == '\t'))
+            ++i;
+        if (i == n || '[' != s[i])
+            return 1;
+        const size_t threads = config->getThreads();
+        return (0 != threads) ? threads : std::thread::hardware_concurrency();
+    }
+
+    std::shared_ptr<IMPLEMENT::ValueBase> vp;
+    // Keeps the memory of an in-situ document alive
+    std::shared_ptr<void> doc;
+};
+
+// Pull parser: a forward-only cursor over the tokens of a document. Nothing is
+// allocated per token; string views point into the input (or a scratch buffer
+// when they had to be decoded) and are valid until the next call to next().
+class JsonReader : private IMPLEMENT::Parser
+{
+public:
+    JsonReader(const char* s, size_t n, const ParseConfig* config = nullptr)
+        : IMPLEMENT::Parser(s, n, config), token(TokenNone), str(nullptr), strSize(0), boolean(false), afterKey(false), done(false)
     {
     }
-    ~Parser() {}
+    virtual ~JsonReader() {}
 
-    inline size_t getPos() const { return pos; }
-    inline JsonError getError() const { return error; }
-    inline bool failed() const { return (0 != error); }
-    virtual void reset() { stm.seekg(0); }
+    using IMPLEMENT::Parser::getPos;
+    using IMPLEMENT::Parser::getError;
+    using IMPLEMENT::Parser::failed;
 
-    ValueType checkValueType()
+    // Move to the next token. Returns false at the end of the document or on
+    // error (see getError()).
+    inline bool next() { return advance(false); }
+
+    // Skip the next value, including all its children. When a key is expected
+    // the whole member is skipped. The cursor is left on the last token of the
+    // skipped value.
+    inline bool skipValue() { return advance(true); }
+
+    // Move to the next token, which must start an object/array
+    inline bool enterObject() { return enter(TokenStartObject); }
+    inline bool enterArray() { return enter(TokenStartArray); }
+
+    inline TokenType tokenType() const { return token; }
+    // Number of open objects/arrays
+    inline size_t depth() const { return stack.size(); }
+
+    // Key or string token
+    inline bool getStringView(const char*& s, size_t& n) const
     {
-        char c = peekNextNotSpace();
-        switch (c)
+        if (TokenKey != token && TokenString != token)
+            return false;
+        s = str;
+        n = strSize;
+        return true;
+    }
+    inline std::string getString() const
+    {
+        return (TokenKey == token || TokenString == token) ? std::string(str, strSize) : std::string();
+    }
+    // Compare the current key or string with a null-terminated string
+    inline bool equals(const char* s) const
+    {
+        return (TokenKey == token || TokenString == token) && strSize == strlen(s) && 0 == memcmp(str, s, strSize);
+    }
+
+    inline bool getBoolean() const { return (TokenBoolean == token) && boolean; }
+    inline bool isIntegerNumber() const { return (TokenNumber == token) && IMPLEMENT::NumberToken::Double != num.type; }
+    inline int64_t getInt64() const
+    {
+        if (TokenNumber != token)
+            return 0;
+        switch (num.type)
         {
-        case 'n':
-        case 'N':
-            return JsonNull;
-        case 't':
-        case 'T':
-        case 'f':
-        case 'F':
-            return JsonBoolean;
-        case '-':
-        case '0':
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-            return JsonNumber;
-        case '\"':
-            return JsonString;
-        case '{':
-            return JsonObject;
-        case '[':
-            return JsonArray;
+        case IMPLEMENT::NumberToken::Int64:
+            return num.i;
+        case IMPLEMENT::NumberToken::Uint64:
+            return static_cast<int64_t>(num.u);
         default:
             break;
         }
-        return JsonUnknown;
+        return static_cast<int64_t>(num.d);
     }
-
-    IMPLEMENT::ValueBase* readValue()
+    inline uint64_t getUint64() const
     {
-        const ValueType type = checkValueType();
-
-        switch (type)
+        if (TokenNumber != token)
+            return 0;
+        switch (num.type)
         {
-        case JsonNull:
-            return readValueNull();
-        case JsonBoolean:
-            return readValueBoolean();
-        case JsonNumber:
-            return readValueNumber();
-        case JsonString:
-            return readValueString();
-        case JsonObject:
-            return readValueObject();
-        case JsonArray:
-            return readValueArray();
+        case IMPLEMENT::NumberToken::Int64:
+            return static_cast<uint64_t>(num.i);
+        case IMPLEMENT::NumberToken::Uint64:
+            return num.u;
         default:
             break;
         }
-
-        error = JEUnexpectedChar;
-        return nullptr;
+        return static_cast<uint64_t>(num.d);
     }
-
-#ifndef _DEBUG
-protected:
-#endif
-    char peekNext() const
+    inline double getDecimal() const
     {
-        return stm.eof() ? -1 : stm.peek();
+        if (TokenNumber != token)
+            return 0.0;
+        switch (num.type)
+        {
+        case IMPLEMENT::NumberToken::Int64:
+            return static_cast<double>(num.i);
+        case IMPLEMENT::NumberToken::Uint64:
+            return static_cast<double>(num.u);
+        default:
+            break;
+        }
+        return num.d;
     }
 
-    char readNext()
+private:
+    bool enter(TokenType expected)
     {
-        char ch = -1;
-        if(!stm.eof())
+        if (!next())
+            return false;
+        if (expected != token)
         {
-            stm.read(&ch, 1);
-            ++pos;
+            setError(JEMismatchValueType);
+            return false;
         }
-        return ch;
+        return true;
     }
 
-    char peekNextNotSpace()
+    bool advance(bool skip)
     {
-        char ch = peekNext();
-        while (!stm.eof() && std::isspace(ch))
+        if (failed() || done)
         {
-            readNext();
-            ch = peekNext();
+            token = TokenNone;
+            return false;
         }
-        return ch;
-    }
 
-    IMPLEMENT::ValueNull* readValueNull()
-    {
-        // null
-        do {
-            char c = readNext();
-            if (c != 'n' && c != 'N')
+        char c = peekNextNotSpace();
+
+        // Key or end of object
+        if (!stack.empty() && !afterKey)
+        {
+            const char close = ('{' == stack.back()) ? '}' : ']';
+            while (',' == c)
             {
-                error = JEMismatchValueType;
-                break;
+                readNext();
+                c = peekNextNotSpace();
             }
-            c = readNext();
-            if (c != 'u')
+            if (eof())
+                return stop(JEUnexpectedEnd);
+            if (close == c)
             {
-                error = JEUnexpectedChar;
-                break;
+                readNext();
+                stack.pop_back();
+                token = ('}' == close) ? TokenEndObject : TokenEndArray;
+                endValue();
+                return true;
             }
-            c = readNext();
-            if (c != 'l')
+            if ('}' == close)
             {
-                error = JEUnexpectedChar;
-                break;
+                if ('\"' != c)
+                    return stop(JEUnexpectedChar);
+                if (!readStringView(str, strSize))
+                    return stop(JESuccess);
+                c = peekNextNotSpace();
+                if (':' != c)
+                    return stop(eof() ? JEUnexpectedEnd : JEMissingColon);
+                readNext();
+                afterKey = true;
+                token = TokenKey;
+                if (!skip)
+                    return true;
+                c = peekNextNotSpace();
             }
-            c = readNext();
-            if (c != 'l')
+        }
+
+        // Value
+        afterKey = false;
+        switch (c)
+        {
+        case '{':
+        case '[':
+            if (skip)
             {
-                error = JEUnexpectedChar;
+                if (!IMPLEMENT::Parser::skipValue())
+                    return stop(JESuccess);
+                token = ('{' == c) ? TokenEndObject : TokenEndArray;
+                endValue();
+                return true;
+            }
+            if (!checkDepth(stack.size()))
+                return stop(JESuccess);
+            readNext();
+            stack.push_back(c);
+            token = ('{' == c) ? TokenStartObject : TokenStartArray;
+            return true;
+        case '\"':
+            if (!readStringView(str, strSize))
+                return stop(JESuccess);
+            token = TokenString;
+            break;
+        case 'n':
+        case 'N':
+            if (!readNull())
+                return stop(JESuccess);
+            token = TokenNull;
+            break;
+        case 't':
+        case 'T':
+        case 'f':
+        case 'F':
+            if (!readBoolean(boolean))
+                return stop(JESuccess);
+            token = TokenBoolean;
+            break;
+        default:
+            if ('-' == c || (c >= '0' && c <= '9'))
+            {
+                if (!readNumber(num))
+                    return stop(JESuccess);
+                token = TokenNumber;
                 break;
             }
-        } while (false);
-        return failed() ? nullptr : IMPLEMENT::ValueNull::create();
+            return stop(eof() ? JEUnexpectedEnd : JEUnexpectedChar);
+        }
+        endValue();
+        return true;
     }
 
-    IMPLEMENT::ValueBoolean* readValueBoolean()
+    inline void endValue()
     {
-        // true/false
-        bool result = false;
-        do {
-            char c = readNext();
-            if (c == 't' || c == 'T')
+        if (stack.empty())
+            done = true;
+    }
+
+    // e is JESuccess when the parser has already set the error
+    inline bool stop(JsonError e)
+    {
+        if (JESuccess != e)
+            setError(e);
+        token = TokenNone;
+        return false;
+    }
+
+private:
+    TokenType token;
+    const char* str;
+    size_t strSize;
+    bool boolean;
+    IMPLEMENT::NumberToken num;
+    // '{' or '[' for each open container
+    std::vector<char> stack;
+    bool afterKey;
+    bool done;
+};
+
+// Incremental parser for input which arrives in chunks (e.g. from a socket).
+// feed() accepts arbitrary chunk boundaries, also inside a string, number or
+// escape sequence; only the bytes of a token that is split between chunks are
+// kept. The state lives in an explicit stack of open containers. Documents
+// may follow each other without separator.
+class PushParser : private IMPLEMENT::Parser
+{
+public:
+    explicit PushParser(const ParseConfig* config = nullptr)
+        : IMPLEMENT::Parser(), tokType(TokNone), tokEscape(false), done(false), used(0)
+    {
+        configure(config);
+    }
+    virtual ~PushParser() {}
+
+    using IMPLEMENT::Parser::getError;
+    using IMPLEMENT::Parser::failed;
+
+    // Consume bytes until a top-level value is complete (ValueComplete, see
+    // value()) or all of them are used (NeedMoreData). The bytes after a
+    // complete value are not consumed: feed them again, consumed() tells how
+    // many bytes of s were used.
+    FeedStatus feed(const char* s, size_t n)
+    {
+        used = 0;
+        if (failed())
+            return FeedError;
+        if (done)
+            clearDocument();
+        // A document is read into one arena, across the calls
+        if (nullptr == getArena() && stack.empty() && TokNone == tokType)
+            openArena();
+        IMPLEMENT::Arena::Scope scope(getArena());
+
+        size_t i = 0;
+        while (i < n)
+        {
+            if (TokNone != tokType)
             {
-                c = readNext();
-                if (c != 'r')
-                {
-                    error = JEUnexpectedChar;
-                    break;
-                }
-                c = readNext();
-                if (c != 'u')
-                {
-                    error = JEUnexpectedChar;
-                    break;
-                }
-                c = readNext();
-                if (c != 'e')
+                i = readToken(s, n, i);
+            }
+            else
+            {
+                const char c = s[i];
+                if (isSpace(c))
                 {
-                    error = JEUnexpectedChar;
-                    break;
+                    ++i;
+                    continue;
                 }
-                result = true;
+                i = readStructure(c, i);
             }
-            else if (c == 'f' || c == 'F')
+
+            if (failed())
+            {
+                used = i;
+                return FeedError;
+            }
+            if (done)
+            {
+                used = i;
+                return ValueComplete;
+            }
+        }
+
+        used = n;
+        return NeedMoreData;
+    }
+
+    // End of input. Completes a top-level number, which can't end otherwise.
+    FeedStatus finish()
+    {
+        used = 0;
+        if (failed())
+            return FeedError;
+        if (done)
+            clearDocument();
+        if (TokNumber == tokType && stack.empty())
+        {
+            IMPLEMENT::Arena::Scope scope(getArena());
+            completeToken(tok.data(), tok.size());
+            return failed() ? FeedError : ValueComplete;
+        }
+        if (TokNone != tokType || !stack.empty())
+        {
+            setError(JEUnexpectedEnd);
+            return FeedError;
+        }
+        return NeedMoreData;
+    }
+
+    inline size_t consumed() const { return used; }
+
+    // The last complete document
+    inline Value value() const { return done ? Value(root) : Value(std::shared_ptr<IMPLEMENT::ValueBase>()); }
+
+    virtual void reset()
+    {
+        clearDocument();
+        setError(JESuccess);
+    }
+
+private:
+    typedef enum TokType {
+        TokNone = 0,
+        TokString,
+        TokKey,
+        TokNumber,
+        TokLiteral
+    } TokType;
+
+    // An open object or array
+    struct Frame
+    {
+        Frame(IMPLEMENT::ValueBase* p, bool o) : container(p), object(o), hasKey(false), colon(false) {}
+
+        IMPLEMENT::ValueBase* container;
+        bool object;
+        bool hasKey;
+        bool colon;
+        IMPLEMENT::StringData key;
+    };
+
+    void clearDocument()
+    {
+        root.reset();
+        stack.clear();
+        closeArena();
+        tok.clear();
+        tokType = TokNone;
+        tokEscape = false;
+        done = false;
+    }
+
+    static inline bool isNumberChar(char c)
+    {
+        return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+    }
+
+    // Handle a non-space character between tokens, returns the next position
+    size_t readStructure(char c, size_t i)
+    {
+        if (!stack.empty())
+        {
+            Frame& f = stack.back();
+            if (f.object && !f.hasKey)
             {
-                c = readNext();
-                if (c != 'a')
-                {
-                    error = JEUnexpectedChar;
-                    break;
-                }
-                c = readNext();
-                if (c != 'l')
-                {
-                    error = JEUnexpectedChar;
-                    break;
-                }
-                c = readNext();
-                if (c != 's')
+                if (',' == c)
+                    return i + 1;
+                if ('}' == c)
+                    return close(i);
+                if ('\"' != c)
                 {
-                    error = JEUnexpectedChar;
-                    break;
+                    setError(JEUnexpectedChar);
+                    return i;
                 }
-                c = readNext();
-                if (c != 'e')
+                tokType = TokKey;
+                return i;
+            }
+            if (f.object && !f.colon)
+            {
+                if (':' != c)
                 {
-                    error = JEUnexpectedChar;
-                    break;
+                    setError(JEMissingColon);
+                    return i;
                 }
-                result = false;
+                f.colon = true;
+                return i + 1;
             }
-            else
+            if (!f.object)
             {
-                error = JEMismatchValueType;
+                if (',' == c)
+                    return i + 1;
+                if (']' == c)
+                    return close(i);
             }
-        } while (false);
+        }
 
-        return failed() ? nullptr : IMPLEMENT::ValueBoolean::create(result);
+        // Start of a value
+        switch (c)
+        {
+        case '{':
+        case '[':
+        {
+            if (!checkDepth(stack.size()))
+                return i;
+            IMPLEMENT::ValueBase* p = ('{' == c)
+                ? static_cast<IMPLEMENT::ValueBase*>(IMPLEMENT::ValueObject::create())
+                : static_cast<IMPLEMENT::ValueBase*>(IMPLEMENT::ValueArray::create());
+            // Children are added to their parent at once, the document only
+            // has to own the root
+            attach(p);
+            stack.push_back(Frame(p, '{' == c));
+            return i + 1;
+        }
+        case '\"':
+            tokType = TokString;
+            break;
+        case 'n':
+        case 'N':
+        case 't':
+        case 'T':
+        case 'f':
+        case 'F':
+            tokType = TokLiteral;
+            break;
+        default:
+            if ('-' == c || (c >= '0' && c <= '9'))
+            {
+                tokType = TokNumber;
+                break;
+            }
+            setError(JEUnexpectedChar);
+            break;
+        }
+        return i;
     }
 
-    IMPLEMENT::ValueNumber* readValueNumber()
+    size_t close(size_t i)
     {
-        // Number = [minus] int [frac] [exp]
-        // {
-        //    decimal - point = %x2E; .
-        //    digit1 - 9 = %x31 - 39; 1 - 9
-        //    e = %x65 / %x45; e E
-        //    exp = e[minus / plus] 1 * DIGIT
-        //    frac = decimal - point 1 * DIGIT
-        //    int = zero / (digit1 - 9 * DIGIT)
-        //    minus = %x2D; -
-        //    plus = %x2B; +
-        //    zero = %x30; 0
-        // }
-
-        char c = peekNextNotSpace();
-        bool dotFlag = false;
-        bool eFlag = false;
-        bool signFlag = false;
+        if (stack.back().object && !buildObject(static_cast<IMPLEMENT::ValueObject*>(stack.back().container)))
+            return i;
+        stack.pop_back();
+        if (stack.empty())
+            done = true;
+        return i + 1;
+    }
 
-        std::string s;
+    // Continue the current token, returns the next position
+    size_t readToken(const char* s, size_t n, size_t i)
+    {
+        // The first byte of a token is only kept once the token is split
+        const bool fresh = tok.empty();
+        size_t j = i;
 
-        if (c == '-')
+        switch (tokType)
         {
-            signFlag = true;
-            s.append(&c, &c + 1);
-            readNext();
-            c = peekNext();
-        }
-
-        do {
-
-            if (c == '-')
+        case TokString:
+        case TokKey:
+            if (fresh)
+                ++j;
+            if (tokEscape && j < n)
             {
-                error = JEUnexpectedChar;
-                break;
-            }
-            else if (c == '.')
-            {
-                if (dotFlag)
-                {
-                    error = JEUnexpectedChar;
-                    break;
-                }
-                else
-                {
-                    dotFlag = true;
-                    s.append(&c, &c + 1);
-                    readNext();
-                    c = peekNext();
-                }
+                tokEscape = false;
+                ++j;
             }
-            else if (c == 'e' || c == 'E')
+            while (j < n)
             {
-                if (eFlag)
-                {
-                    error = JEUnexpectedChar;
+                const char c = s[j];
+                if ('\"' == c)
                     break;
-                }
-                
-                eFlag = true;
-                s.append(&c, &c + 1);
-                readNext();
-                c = peekNext();
-                if (c == '+' || c == '-')
+                if ('\\' == c)
                 {
-                    s.append(&c, &c + 1);
-                    readNext();
-                    c = peekNext();
+                    if (j + 1 == n)
+                    {
+                        tokEscape = true;
+                        ++j;
+                        break;
+                    }
+                    ++j;
                 }
+                ++j;
             }
-            else
+            if (j < n)
             {
-                if (c <'0' || c > '9')
-                {
-                    break;
-                }
-                s.append(&c, &c + 1);
-                readNext();
-                c = peekNext();
+                ++j;
+                return complete(s, i, j);
             }
+            break;
+        case TokNumber:
+            while (j < n && isNumberChar(s[j]))
+                ++j;
+            if (j < n)
+                return complete(s, i, j);
+            break;
+        case TokLiteral:
+        {
+            const char first = fresh ? s[i] : tok[0];
+            const size_t len = ('f' == first || 'F' == first) ? 5 : 4;
+            const size_t need = len - tok.size();
+            j = (n - i < need) ? n : (i + need);
+            if (j - i == need)
+                return complete(s, i, j);
+            break;
+        }
+        default:
+            break;
+        }
 
-        } while (!stm.eof());
-
-        if (failed())
-            return nullptr;
-
-        IMPLEMENT::ValueNumber* pNumber = nullptr;
+        tok.append(s + i, j - i);
+        return j;
+    }
 
-        if (dotFlag || eFlag)
+    size_t complete(const char* s, size_t i, size_t j)
+    {
+        if (tok.empty())
         {
-            // Decimal
-            pNumber = IMPLEMENT::ValueNumber::create(std::stod(s));
+            completeToken(s + i, j - i);
         }
         else
         {
-            // Integer
-            pNumber = IMPLEMENT::ValueNumber::create(std::stoll(s));
+            tok.append(s + i, j - i);
+            completeToken(tok.data(), tok.size());
         }
+        return j;
+    }
 
-        if (pNumber == nullptr)
-            error = JEBadAlloc;
+    void completeToken(const char* s, size_t n)
+    {
+        const TokType type = tokType;
+        tokType = TokNone;
+        tokEscape = false;
+        assign(s, n);
+
+        IMPLEMENT::ValueBase* p = nullptr;
+        switch (type)
+        {
+        case TokKey:
+            if (readKey(stack.back().key))
+                stack.back().hasKey = true;
+            break;
+        case TokString:
+            p = readValueString();
+            break;
+        case TokNumber:
+            // The token is copied, it doesn't outlive the call
+            p = useRawNumbers() ? static_cast<IMPLEMENT::ValueBase*>(readRawNumber()) : static_cast<IMPLEMENT::ValueBase*>(readValueNumber());
+            break;
+        default:
+            p = ('n' == s[0] || 'N' == s[0]) ? static_cast<IMPLEMENT::ValueBase*>(readValueNull())
+                                             : static_cast<IMPLEMENT::ValueBase*>(readValueBoolean());
+            break;
+        }
+        tok.clear();
 
-        return pNumber;
+        // The whole token must have been used
+        if (!failed() && getPos() != n)
+            setError(JEUnexpectedChar);
+        if (failed())
+        {
+            delete p;
+            return;
+        }
+        if (nullptr != p)
+        {
+            attach(p);
+            if (stack.empty())
+                done = true;
+        }
     }
 
-    std::string readEscapedString()
+    void attach(IMPLEMENT::ValueBase* p)
     {
-        char c = readNext();
-        if (c != '\"')
+        std::shared_ptr<IMPLEMENT::ValueBase> sp(adopt(p));
+        if (stack.empty())
         {
-            error = JEMismatchValueType;
-            return nullptr;
+            root = sp;
+            return;
         }
+        Frame& f = stack.back();
+        if (f.object)
+        {
+            static_cast<IMPLEMENT::ValueObject*>(f.container)->append(std::move(f.key), sp);
+            f.key.clear();
+            f.hasKey = false;
+            f.colon = false;
+        }
+        else
+        {
+            static_cast<IMPLEMENT::ValueArray*>(f.container)->push_back(sp);
+        }
+    }
 
-        std::string s;
-
-        do {
+private:
+    std::shared_ptr<IMPLEMENT::ValueBase> root;
+    std::vector<Frame> stack;
+    // Bytes of a token split between chunks
+    std::string tok;
+    TokType tokType;
+    bool tokEscape;
+    bool done;
+    size_t used;
+};
 
-            c = readNext();
-            if (stm.eof())
-            {
-                error = JEUnexpectedEnd;
-                break;
-            }
+// SAX parsing: the document is reported to handler as events (see BaseHandler)
+// and no Value is built. Returns the error which stopped the parser, if any.
+template<typename Handler>
+JsonError parse(const char* s, size_t n, Handler& handler, const ParseConfig* config = nullptr)
+{
+    IMPLEMENT::Parser parser(s, n, config);
+    parser.readValue(handler);
+    return parser.getError();
+}
 
-            // Finish
-            if ('\"' == c)
-                break;
+template<typename Handler>
+JsonError parse(const std::string& s, Handler& handler, const ParseConfig* config = nullptr)
+{
+    return parse(s.data(), s.size(), handler, config);
+}
 
-            s.append(&c, &c + 1);
+// Same as above, strings with escapes are decoded in place inside s instead of
+// a scratch buffer. s is modified.
+template<typename Handler>
+JsonError parseInSitu(char* s, size_t n, Handler& handler, const ParseConfig* config = nullptr)
+{
+    IMPLEMENT::InSituParser parser(s, n, config);
+    parser.readValue(handler);
+    return parser.getError();
+}
 
-            if ('\\' == c)
-            {
-                c = readNext();
-                if (stm.eof())
-                {
-                    error = JEUnexpectedEnd;
-                    break;
-                }
-                s.append(&c, &c + 1);
-            }
+// Check that s holds one well-formed value, optionally surrounded by
+// whitespace, with valid UTF-8 in its strings. Nothing is built or decoded.
+// The grammar is strict RFC 8259, Value::parse() is more lenient (missing or
+// extra ',' and upper case literals). The reason of a failure is stored in
+// error if given.
+inline bool validate(const char* s, size_t n, JsonError* error = nullptr)
+{
+    IMPLEMENT::Parser parser(s, n);
+    JsonError e = JESuccess;
+    if (!parser.skipValue(true))
+        e = parser.getError();
+    else
+    {
+        // Only whitespace may follow
+        parser.checkValueType();
+        if (parser.getPos() < n)
+            e = JEUnexpectedChar;
+    }
+    if (error)
+        *error = e;
+    return (JESuccess == e);
+}
 
-        } while (true);
+inline bool validate(const std::string& s, JsonError* error = nullptr)
+{
+    return validate(s.data(), s.size(), error);
+}
 
-        return s;
+// Parser state kept between documents, for parsing many (small) documents
+// one after another. The decoded-string scratch, the structural index and the
+// nesting stack keep their capacity, so once warmed up only the values
+// themselves are allocated. One context per thread.
+class ParserContext : private IMPLEMENT::Parser
+{
+public:
+    explicit ParserContext(const ParseConfig* config = nullptr)
+        : IMPLEMENT::Parser(nullptr, 0), config(config)
+    {
     }
+    virtual ~ParserContext() {}
 
-    IMPLEMENT::ValueString* readValueString()
+    using IMPLEMENT::Parser::getPos;
+    using IMPLEMENT::Parser::getError;
+    using IMPLEMENT::Parser::failed;
+
+    Value parse(const char* s, size_t n)
     {
-        const std::string& s = readEscapedString();
-        return failed() ? nullptr : IMPLEMENT::ValueString::create(s, true);
+        // Lazy and parallel documents have their own parsers
+        if (nullptr != config && (config->useLazy() || config->getThreads() != 1))
+            return Value::parse(s, n, config);
+
+        start(s, n);
+        return Value(readRoot());
     }
 
-    IMPLEMENT::ValueObject* readValueObject()
+    Value parse(const std::string& s)
     {
-        char c = readNext();
-        if (c != '{')
-        {
-            error = JEMismatchValueType;
-            return nullptr;
-        }
-
-        IMPLEMENT::ValueObject* pObject = IMPLEMENT::ValueObject::create();
-        if(nullptr == pObject)
-        {
-            error = JEBadAlloc;
-            return nullptr;
-        }
+        return parse(s.data(), s.size());
+    }
 
-        do {
+    // Same as Value::parseInSitu(), s is modified and must outlive the result
+    Value parseInSitu(char* s, size_t n)
+    {
+        if (nullptr != config && (config->useLazy() || config->getThreads() != 1))
+            return Value::parseInSitu(s, n, config);
 
-            c = peekNextNotSpace();
-            if(stm.eof())
-            {
-                error = JEUnexpectedEnd;
-                break;
-            }
+        assignInSitu(s, n);
+        configure(config);
+        return Value(readRoot());
+    }
 
-            // Done
-            if (c == '}')
-            {
-                readNext();
-                break;
-            }
+    // SAX, see JSONX::parse()
+    template<typename Handler>
+    JsonError parse(const char* s, size_t n, Handler& handler)
+    {
+        start(s, n);
+        readValue(handler);
+        return getError();
+    }
 
-            if (c == ',')
-            {
-                readNext();
-                continue;
-            }
+    // See JSONX::validate()
+    bool validate(const char* s, size_t n)
+    {
+        start(s, n);
+        if (!skipValue(true))
+            return false;
+        // Only whitespace may follow
+        peekNextNotSpace();
+        if (!eof())
+        {
+            setError(JEUnexpectedChar);
+            return false;
+        }
+        return true;
+    }
 
-            if('\"' != c)
-            {
-                error = JEUnexpectedChar;
-                break;
-            }
+private:
+    void start(const char* s, size_t n)
+    {
+        assign(s, n);
+        configure(config);
+    }
 
-            // Read key
-            const std::string& key = readEscapedString();
-            if (failed())
-                break;
+private:
+    const ParseConfig* config;
+};
 
-            // Read colon
-            c = peekNextNotSpace();
-            if (failed())
-                break;
-            if (c != ':')
-            {
-                error = JEMissingColon;
-                break;
-            }
-            // Skip it
-            readNext();
+// Reader of newline-delimited documents (NDJSON / JSON Lines). Blank lines are
+// skipped. Lines are parsed straight from the input, either one by one or on
+// several worker threads.
+class JsonLinesReader
+{
+public:
+    explicit JsonLinesReader(const ParseConfig* config = nullptr)
+        : config(config), buf(nullptr), bufSize(0), pos(0)
+    {
+    }
+    // The input must outlive the reader
+    JsonLinesReader(const char* s, size_t n, const ParseConfig* config = nullptr)
+        : config(config), buf(s), bufSize(n), pos(0)
+    {
+    }
+    virtual ~JsonLinesReader() {}
 
-            // Read Value
-            IMPLEMENT::ValueBase* value = readValue();
-            if (failed() || value == nullptr)
-                break;
+    // The input must outlive the reader
+    void assign(const char* s, size_t n)
+    {
+        file.reset();
+        buf = s;
+        bufSize = n;
+        pos = 0;
+    }
 
-            // Insert new child item
-            pObject->set(Utils::unescape(key), std::shared_ptr<IMPLEMENT::ValueBase>(value));
+    // Map the file, the reader keeps the mapping
+    bool open(const std::string& path)
+    {
+        std::shared_ptr<IMPLEMENT::MappedFile> mf(new IMPLEMENT::MappedFile());
+        if (!mf->open(path, nullptr != config && config->usePopulate()))
+            return false;
+        assign(mf->data(), mf->size());
+        file = mf;
+        return true;
+    }
 
-        } while (true);
+    inline bool eof() const { return !hasLine(pos, bufSize); }
 
-        if (failed())
-        {
-            delete pObject;
-            pObject = nullptr;
-        }
+    // Parse the next line, v is invalid if it is malformed. Returns false at
+    // the end of the input.
+    bool next(Value& v)
+    {
+        const char* line = nullptr;
+        size_t n = 0;
+        if (!nextLine(pos, bufSize, line, n))
+            return false;
+        v = Value::parse(line, n, config);
+        return true;
+    }
 
-        return pObject;
+    // Report the next line to handler (see BaseHandler), e is set to its
+    // error. Returns false at the end of the input.
+    template<typename Handler>
+    bool next(Handler& handler, JsonError& e)
+    {
+        const char* line = nullptr;
+        size_t n = 0;
+        if (!nextLine(pos, bufSize, line, n))
+            return false;
+        e = JSONX::parse(line, n, handler, config);
+        return true;
     }
 
-    IMPLEMENT::ValueArray* readValueArray()
+    // Parse all remaining lines on worker threads (0: one per core). The input
+    // is split into newline-aligned chunks; each record is passed to
+    // callback(const Value&) on the calling thread, in input order or, if
+    // ordered is false, as soon as its chunk is done. Malformed lines are
+    // passed as invalid values. At most two chunks per worker are parsed
+    // ahead of the callback. An exception of a worker is thrown again on the
+    // calling thread. Returns the number of records.
+    template<typename Callback>
+    size_t parse(Callback callback, size_t threads = 0, bool ordered = true)
     {
-        char c = readNext();
-        if (c != '[')
-        {
-            error = JEMismatchValueType;
-            return nullptr;
-        }
+        if (0 == threads)
+            threads = std::thread::hardware_concurrency();
 
-        IMPLEMENT::ValueArray* pArray = IMPLEMENT::ValueArray::create();
-        if (nullptr == pArray)
+        std::vector<Chunk> chunks;
+        split(threads, chunks);
+        pos = bufSize;
+
+        size_t count = 0;
+        if (threads <= 1 || chunks.size() <= 1)
         {
-            error = JEBadAlloc;
-            return nullptr;
+            for (size_t i = 0; i < chunks.size(); ++i)
+            {
+                size_t p = static_cast<size_t>(chunks[i].begin - buf);
+                const char* line = nullptr;
+                size_t n = 0;
+                while (nextLine(p, static_cast<size_t>(chunks[i].end - buf), line, n))
+                {
+                    const Value& v = Value::parse(line, n, config);
+                    callback(v);
+                    ++count;
+                }
+            }
+            return count;
         }
 
-        do {
-
-            c = peekNextNotSpace();
-            if (stm.eof())
+        const size_t workers = (threads < chunks.size()) ? threads : chunks.size();
+        // Chunks parsed ahead of the first one not delivered yet, so that a
+        // slow callback doesn't leave the whole input parsed in memory
+        const size_t window = 2 * workers;
+        std::mutex m;
+        std::condition_variable cv;
+        size_t nextChunk = 0;
+        size_t first = 0;
+        bool stop = false;
+
+        auto worker = [&]() {
+            for (;;)
             {
-                error = JEUnexpectedEnd;
-                break;
+                size_t id = 0;
+                {
+                    std::unique_lock<std::mutex> lock(m);
+                    cv.wait(lock, [&]() -> bool { return stop || nextChunk >= chunks.size() || nextChunk < first + window; });
+                    if (stop || nextChunk >= chunks.size())
+                        break;
+                    id = nextChunk++;
+                }
+                std::vector<Value> values;
+                std::exception_ptr e;
+                try
+                {
+                    size_t p = static_cast<size_t>(chunks[id].begin - buf);
+                    const char* line = nullptr;
+                    size_t n = 0;
+                    while (nextLine(p, static_cast<size_t>(chunks[id].end - buf), line, n))
+                        values.push_back(Value::parse(line, n, config));
+                }
+                catch (...)
+                {
+                    e = std::current_exception();
+                }
+                {
+                    std::lock_guard<std::mutex> lock(m);
+                    chunks[id].values.swap(values);
+                    chunks[id].error = e;
+                    chunks[id].ready = true;
+                    if (e)
+                        stop = true;
+                }
+                cv.notify_all();
+                if (e)
+                    break;
             }
+        };
 
-            // Done
-            if (c == ']')
+        std::vector<std::thread> pool;
+        try
+        {
+            for (size_t i = 0; i < workers; ++i)
+                pool.push_back(std::thread(worker));
+
+            for (size_t done = 0; done < chunks.size(); ++done)
             {
-                readNext();
-                break;
+                std::vector<Value> values;
+                std::exception_ptr e;
+                {
+                    std::unique_lock<std::mutex> lock(m);
+                    size_t id = first;
+                    cv.wait(lock, [&]() -> bool {
+                        if (stop)
+                            return true;
+                        if (ordered)
+                            return chunks[id].ready;
+                        for (id = first; id < chunks.size(); ++id)
+                        {
+                            if (chunks[id].ready && !chunks[id].taken)
+                                return true;
+                        }
+                        return false;
+                    });
+                    if (stop)
+                    {
+                        // Only a worker stops the others at this point
+                        for (size_t i = 0; i < chunks.size() && !e; ++i)
+                            e = chunks[i].error;
+                    }
+                    else
+                    {
+                        values.swap(chunks[id].values);
+                        chunks[id].taken = true;
+                        while (first < chunks.size() && chunks[first].taken)
+                            ++first;
+                    }
+                }
+                if (e)
+                    std::rethrow_exception(e);
+                cv.notify_all();
+                for (size_t i = 0; i < values.size(); ++i)
+                    callback(static_cast<const Value&>(values[i]));
+                count += values.size();
             }
-
-            if (c == ',')
+        }
+        catch (...)
+        {
             {
-                readNext();
-                continue;
+                std::lock_guard<std::mutex> lock(m);
+                stop = true;
             }
+            cv.notify_all();
+            for (size_t i = 0; i < pool.size(); ++i)
+                pool[i].join();
+            throw;
+        }
 
-            // Read Value
-            IMPLEMENT::ValueBase* value = readValue();
-            if (failed() || value == nullptr)
-                break;
+        for (size_t i = 0; i < pool.size(); ++i)
+            pool[i].join();
+        return count;
+    }
 
-            // Insert new child item
-            pArray->push_back(std::shared_ptr<IMPLEMENT::ValueBase>(value));
+private:
+    struct Chunk
+    {
+        Chunk(const char* b, const char* e) : begin(b), end(e), ready(false), taken(false) {}
+
+        const char* begin;
+        const char* end;
+        std::vector<Value> values;
+        // Thrown by the worker which parsed the chunk
+        std::exception_ptr error;
+        bool ready;
+        bool taken;
+    };
 
-        } while (true);
+    static inline bool isSpace(char c)
+    {
+        return (c == ' ' || c == '\n' || c == '\r' || c == '\t');
+    }
 
-        if (failed())
+    // Is there a non-blank line in [p, end)
+    bool hasLine(size_t p, size_t end) const
+    {
+        while (p < end && isSpace(buf[p]))
+            ++p;
+        return (p < end);
+    }
+
+    // Next non-blank line in [p, end), p is moved past it
+    bool nextLine(size_t& p, size_t end, const char*& line, size_t& n) const
+    {
+        while (p < end)
         {
-            delete pArray;
-            pArray = nullptr;
+            const char* s = buf + p;
+            const char* nl = static_cast<const char*>(memchr(s, '\n', end - p));
+            const size_t len = nl ? static_cast<size_t>(nl - s) : (end - p);
+            p += nl ? (len + 1) : len;
+
+            size_t i = 0;
+            while (i < len && isSpace(s[i]))
+                ++i;
+            if (i < len)
+            {
+                line = s;
+                n = len;
+                return true;
+            }
         }
+        return false;
+    }
 
-        return pArray;
+    // Newline-aligned chunks of the rest of the input, several per thread so
+    // that the work stays balanced, and small enough to bound what is parsed
+    // ahead of the callback
+    void split(size_t threads, std::vector<Chunk>& chunks) const
+    {
+        const size_t minChunk = 65536;
+        const size_t maxChunk = 4194304;
+        const size_t rest = bufSize - pos;
+        size_t target = (threads > 1) ? (rest / (threads * 8)) : rest;
+        if (threads > 1 && target > maxChunk)
+            target = maxChunk;
+        if (target < minChunk)
+            target = minChunk;
+
+        size_t p = pos;
+        while (p < bufSize)
+        {
+            size_t e = (bufSize - p <= target) ? bufSize : (p + target);
+            if (e < bufSize)
+            {
+                const char* nl = static_cast<const char*>(memchr(buf + e, '\n', bufSize - e));
+                e = nl ? static_cast<size_t>(nl - buf) + 1 : bufSize;
+            }
+            chunks.push_back(Chunk(buf + p, buf + e));
+            p = e;
+        }
     }
 
 private:
-    std::istream& stm;
+    const ParseConfig* config;
+    std::shared_ptr<IMPLEMENT::MappedFile> file;
+    const char* buf;
+    size_t bufSize;
     size_t pos;
-    JsonError error;
 };
 
-template<typename T>
-class StringParser : public Parser
+class TapeValue;
+
+// Read-only document stored as one contiguous tape of tagged 64-bit words
+// plus a buffer for the strings, instead of a tree of separately allocated
+// nodes. Scalars and strings take one word (numbers a second one for the
+// bits); the start word of an object or array links past its end word, so
+// a value is skipped without walking its children. Parsing again into the
+// same document reuses both buffers.
+class TapeDocument
 {
 public:
-    StringParser(const std::basic_string<T>& s)
-        : iss(Utils::toUtf8(s)), Parser(iss)
-    {
-    }
-    virtual ~StringParser()
+    TapeDocument() : error(JESuccess) {}
+    ~TapeDocument() {}
+
+    bool parse(const char* s, size_t n, const ParseConfig* config = nullptr)
     {
+        tape.clear();
+        strings.clear();
+        stack.clear();
+        // Rough guess, the tape grows if needed
+        if (tape.capacity() < n / 8 + 2)
+            tape.reserve(n / 8 + 2);
+
+        Builder builder(*this);
+        IMPLEMENT::Parser parser(s, n, config);
+        parser.readValue(builder);
+        error = parser.getError();
+        if (JESuccess != error)
+        {
+            tape.clear();
+            strings.clear();
+            return false;
+        }
+        return true;
     }
 
-    virtual void reset(const std::basic_string<T>& s)
+    bool parse(const std::string& s, const ParseConfig* config = nullptr)
     {
-        iss.str(Utils::toUtf8(s));
-        Parser::reset();
+        return parse(s.data(), s.size(), config);
     }
 
+    inline bool valid() const { return !tape.empty(); }
+    inline JsonError getError() const { return error; }
+    TapeValue root() const;
+
+    // Number of tape words and string buffer bytes in use
+    inline size_t tapeSize() const { return tape.size(); }
+    inline size_t stringsSize() const { return strings.size(); }
+
 private:
-    std::istringstream iss;
-};
+    friend class TapeValue;
 
-class ValueFactory
-{
-public:
-    static IMPLEMENT::ValueBase* create(ValueType type)
+    typedef enum Tag
     {
-        switch (type)
+        TagNull = 'n',
+        TagTrue = 't',
+        TagFalse = 'f',
+        TagInt64 = 'l',
+        TagUint64 = 'u',
+        TagDecimal = 'd',
+        TagString = '"',
+        TagStartObject = '{',
+        TagEndObject = '}',
+        TagStartArray = '[',
+        TagEndArray = ']'
+    } Tag;
+
+    // Container start word: index past the end word in the low 32 bits,
+    // element count (saturated) in the next 24 bits
+    static const uint64_t PayloadMask = 0x00FFFFFFFFFFFFFFULL;
+    static const uint64_t IndexMask = 0xFFFFFFFFULL;
+    static const uint64_t CountMax = 0xFFFFFFULL;
+
+    static inline uint64_t word(Tag tag, uint64_t payload) { return (static_cast<uint64_t>(tag) << 56) | payload; }
+    static inline Tag tagOf(uint64_t w) { return static_cast<Tag>(w >> 56); }
+
+    // Index of the value following the one at i
+    inline size_t next(size_t i) const
+    {
+        const uint64_t w = tape[i];
+        switch (tagOf(w))
         {
-        case JsonNull:
-            return IMPLEMENT::ValueNull::create();
-        case JsonBoolean:
-            return IMPLEMENT::ValueBoolean::create(false);
-        case JsonNumber:
-            return IMPLEMENT::ValueNumber::create(0LL);
-        case JsonString:
-            return IMPLEMENT::ValueString::create("", false);
-        case JsonObject:
-            return IMPLEMENT::ValueObject::create(true);
-        case JsonArray:
-            return IMPLEMENT::ValueArray::create();
+        case TagStartObject:
+        case TagStartArray:
+            return static_cast<size_t>(w & IndexMask);
+        case TagInt64:
+        case TagUint64:
+        case TagDecimal:
+            return i + 2;
         default:
-            break;
+            return i + 1;
         }
-        return nullptr;
     }
 
-    static IMPLEMENT::ValueNull* createNull()
+    // Strings are stored as a 32-bit length followed by the bytes
+    inline void string(size_t i, const char*& s, size_t& n) const
     {
-        IMPLEMENT::ValueNull::create();
+        const size_t off = static_cast<size_t>(tape[i] & PayloadMask);
+        uint32_t len;
+        memcpy(&len, strings.data() + off, sizeof(len));
+        s = strings.data() + off + sizeof(len);
+        n = len;
     }
 
-    static IMPLEMENT::ValueBoolean* createBoolean(bool v)
+    bool appendString(const char* s, size_t n)
     {
-        IMPLEMENT::ValueBoolean::create(v);
+        if (n > 0xFFFFFFFFULL)
+            return false;
+        const uint32_t len = static_cast<uint32_t>(n);
+        tape.push_back(word(TagString, strings.size()));
+        strings.append(reinterpret_cast<const char*>(&len), sizeof(len));
+        strings.append(s, n);
+        return true;
     }
 
-    static IMPLEMENT::ValueString* createString(const std::string& s, bool escaped)
+    bool appendNumber(Tag tag, uint64_t bits)
     {
-        IMPLEMENT::ValueString::create(s, escaped);
+        tape.push_back(word(tag, 0));
+        tape.push_back(bits);
+        return true;
     }
 
-    static IMPLEMENT::ValueString* createString(const std::wstring& s, bool escaped)
+    bool start(Tag tag)
     {
-        IMPLEMENT::ValueString::create(s, escaped);
+        stack.push_back(tape.size());
+        tape.push_back(word(tag, 0));
+        return true;
     }
 
-    static IMPLEMENT::ValueObject* createObject(bool keepOrder)
+    bool end(Tag startTag, Tag endTag, size_t count)
     {
-        IMPLEMENT::ValueObject::create(keepOrder);
+        const size_t first = stack.back();
+        stack.pop_back();
+        const uint64_t after = static_cast<uint64_t>(tape.size()) + 1;
+        if (after > IndexMask)
+            return false;
+        uint64_t n = static_cast<uint64_t>(count);
+        if (n > CountMax)
+            n = CountMax;
+        tape[first] = word(startTag, (n << 32) | after);
+        tape.push_back(word(endTag, first));
+        return true;
     }
 
-    static IMPLEMENT::ValueArray* createArray()
+    // SAX events to tape words
+    class Builder : public BaseHandler
     {
-        IMPLEMENT::ValueArray::create();
-    }
-};
+    public:
+        explicit Builder(TapeDocument& d) : doc(d) {}
+
+        bool null() { doc.tape.push_back(word(TagNull, 0)); return true; }
+        bool boolean(bool v) { doc.tape.push_back(word(v ? TagTrue : TagFalse, 0)); return true; }
+        bool int64(int64_t v) { return doc.appendNumber(TagInt64, static_cast<uint64_t>(v)); }
+        bool uint64(uint64_t v) { return doc.appendNumber(TagUint64, v); }
+        bool decimal(double v)
+        {
+            uint64_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            return doc.appendNumber(TagDecimal, bits);
+        }
+        bool string(const char* s, size_t n) { return doc.appendString(s, n); }
+        bool key(const char* s, size_t n) { return doc.appendString(s, n); }
+        bool startObject() { return doc.start(TagStartObject); }
+        bool endObject(size_t count) { return doc.end(TagStartObject, TagEndObject, count); }
+        bool startArray() { return doc.start(TagStartArray); }
+        bool endArray(size_t count) { return doc.end(TagStartArray, TagEndArray, count); }
+
+    private:
+        Builder& operator = (const Builder&);
+        TapeDocument& doc;
+    };
 
-}   // namespace IMPLEMENT
+private:
+    std::vector<uint64_t> tape;
+    std::string strings;
+    std::vector<size_t> stack;
+    JsonError error;
+};
 
-class Value
+// A position in a TapeDocument, which must outlive it. The getters behave
+// like the ones of Value.
+class TapeValue
 {
 public:
-    Value() : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueNull::create())) {}
-    Value(const Value& rhs) : vp(rhs.vp) {}
-    explicit Value(bool v) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueBoolean::create(v))) {}
-    explicit Value(int32_t v) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueNumber::create(v))) {}
-    explicit Value(int64_t v) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueNumber::create(v))) {}
-    explicit Value(uint32_t v) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueNumber::create(v))) {}
-    explicit Value(uint64_t v) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueNumber::create(v))) {}
-    explicit Value(float_t v) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueNumber::create(v))) {}
-    explicit Value(double_t v) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueNumber::create(v))) {}
-    explicit Value(const std::string& v, bool escaped=false) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueString::create(v, escaped))) {}
-    explicit Value(const std::wstring& v, bool escaped=false) : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueString::create(v, escaped))) {}
-    explicit Value(std::shared_ptr<IMPLEMENT::ValueBase> p) : vp(p) {}
-    explicit Value(ValueType vt)
-        : vp(std::shared_ptr<IMPLEMENT::ValueBase>(IMPLEMENT::ValueFactory::create(vt)))
+    TapeValue() : doc(nullptr), idx(0) {}
+    TapeValue(const TapeDocument* d, size_t i) : doc(d), idx(i) {}
+
+    inline bool valid() const { return nullptr != doc; }
+
+    inline bool isNull() const { return is(TapeDocument::TagNull); }
+    inline bool isBoolean() const { return is(TapeDocument::TagTrue) || is(TapeDocument::TagFalse); }
+    inline bool isNumber() const { return is(TapeDocument::TagInt64) || is(TapeDocument::TagUint64) || is(TapeDocument::TagDecimal); }
+    inline bool isString() const { return is(TapeDocument::TagString); }
+    inline bool isObject() const { return is(TapeDocument::TagStartObject); }
+    inline bool isArray() const { return is(TapeDocument::TagStartArray); }
+
+    inline bool getBoolean() const { return is(TapeDocument::TagTrue); }
+
+    inline bool isSignedNumber() const { return is(TapeDocument::TagInt64) || (is(TapeDocument::TagDecimal) && getDecimal() < 0); }
+    inline bool isIntegerNumber() const { return is(TapeDocument::TagInt64) || is(TapeDocument::TagUint64); }
+    inline bool isDecimalNumber() const { return is(TapeDocument::TagDecimal); }
+    inline int32_t getInt32() const { return isDecimalNumber() ? static_cast<int32_t>(getDecimal()) : static_cast<int32_t>(bits()); }
+    inline int64_t getInt64() const { return isDecimalNumber() ? static_cast<int64_t>(getDecimal()) : static_cast<int64_t>(bits()); }
+    inline uint32_t getUint32() const { return isDecimalNumber() ? static_cast<uint32_t>(getDecimal()) : static_cast<uint32_t>(bits()); }
+    inline uint64_t getUint64() const { return isDecimalNumber() ? static_cast<uint64_t>(getDecimal()) : bits(); }
+    inline double_t getDecimal() const
     {
+        if (is(TapeDocument::TagInt64))
+            return static_cast<double>(static_cast<int64_t>(bits()));
+        if (is(TapeDocument::TagUint64))
+            return static_cast<double>(bits());
+        if (!is(TapeDocument::TagDecimal))
+            return 0.0;
+        const uint64_t b = bits();
+        double d;
+        memcpy(&d, &b, sizeof(d));
+        return d;
     }
-    virtual ~Value() {}
 
-    Value& operator = (const Value& rhs)
+    // The view points into the document
+    inline bool getStringView(const char*& s, size_t& n) const
     {
-        if (this != &rhs)
+        if (!isString())
+            return false;
+        doc->string(idx, s, n);
+        return true;
+    }
+    inline std::string getString() const
+    {
+        const char* s = nullptr;
+        size_t n = 0;
+        return getStringView(s, n) ? std::string(s, n) : std::string();
+    }
+
+    // Members of an object, elements of an array, 1 for the others
+    size_t size() const
+    {
+        if (!valid())
+            return 0;
+        if (!isObject() && !isArray())
+            return 1;
+        const uint64_t count = (doc->tape[idx] >> 32) & TapeDocument::CountMax;
+        if (count < TapeDocument::CountMax)
+            return static_cast<size_t>(count);
+
+        // Too many to fit in the start word
+        size_t n = 0;
+        for (size_t i = idx + 1, e = doc->next(idx) - 1; i < e; i = doc->next(i))
         {
-            vp = rhs.vp;
+            if (isObject())
+                i = doc->next(i);
+            ++n;
         }
-        return *this;
+        return n;
     }
 
-    static Value parse(const std::string& s)
+    // Key lookup is case-insensitive, like ValueObject
+    TapeValue operator [](const std::string& key) const
     {
-        std::istringstream ss(s);
-        IMPLEMENT::Parser parser(ss);
-        return Value(std::shared_ptr<IMPLEMENT::ValueBase>(parser.readValue()));
+        if (!isObject())
+            return TapeValue();
+        for (size_t i = idx + 1, e = doc->next(idx) - 1; i < e; )
+        {
+            const char* s;
+            size_t n;
+            doc->string(i, s, n);
+            i = doc->next(i);
+            if (Utils::equal<char>(s, n, key.data(), key.size(), true))
+                return TapeValue(doc, i);
+            i = doc->next(i);
+        }
+        return TapeValue();
     }
 
-    static Value parse(const std::wstring& s)
+    TapeValue operator [](size_t id) const
     {
-        std::istringstream ss(Utils::toUtf8(s));
-        IMPLEMENT::Parser parser(ss);
-        return Value(std::shared_ptr<IMPLEMENT::ValueBase>(parser.readValue()));
+        if (!isArray())
+            return TapeValue();
+        for (size_t i = idx + 1, e = doc->next(idx) - 1; i < e; i = doc->next(i))
+        {
+            if (0 == id--)
+                return TapeValue(doc, i);
+        }
+        return TapeValue();
     }
 
-    static Value parseFile(const std::string& file)
+    // Calls fn(key, keySize, value) for each member of an object
+    template<typename Callback>
+    void forEachMember(Callback fn) const
     {
-        std::ifstream ifs;
-        ifs.open(file, std::ifstream::in);
-        if (!ifs.is_open())
-            return Value(std::shared_ptr<IMPLEMENT::ValueBase>());
-        IMPLEMENT::Parser parser(ifs);
-        return Value(std::shared_ptr<IMPLEMENT::ValueBase>(parser.readValue()));
+        if (!isObject())
+            return;
+        for (size_t i = idx + 1, e = doc->next(idx) - 1; i < e; )
+        {
+            const char* s;
+            size_t n;
+            doc->string(i, s, n);
+            i = doc->next(i);
+            fn(s, n, TapeValue(doc, i));
+            i = doc->next(i);
+        }
     }
 
-    inline bool valid() const { return (nullptr != vp); }
-    inline std::string serialize(SerializeConfig* config = nullptr) const { return vp->serialize(config); }
-    inline size_t size() const { return valid() ? vp->size() : 0; }
-
-    inline bool isNull() const { return valid() && vp->isNull(); }
-    inline bool isBoolean() const { return valid() && vp->isBoolean(); }
-    inline bool isNumber() const { return valid() && vp->isNumber(); }
-    inline bool isString() const { return valid() && vp->isString(); }
-    inline bool isObject() const { return valid() && vp->isObject(); }
-    inline bool isArray() const { return valid() && vp->isArray(); }
-
-    inline bool getBoolean() const { return (isBoolean() && dynamic_cast<IMPLEMENT::ValueBoolean*>(vp.get())->get()); }
-    inline void set(bool v) { if (isBoolean()) dynamic_cast<IMPLEMENT::ValueBoolean*>(vp.get())->set(v); }
+    // Calls fn(value) for each element of an array
+    template<typename Callback>
+    void forEachElement(Callback fn) const
+    {
+        if (!isArray())
+            return;
+        for (size_t i = idx + 1, e = doc->next(idx) - 1; i < e; i = doc->next(i))
+            fn(TapeValue(doc, i));
+    }
 
-    inline bool isSignedNumber() const { return (isNumber() && dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->isSigned()); }
-    inline bool isIntegerNumber() const { return (isNumber() && dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->isInteger()); }
-    inline bool isDecimalNumber() const { return (isNumber() && dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->isDecimal()); }
-    inline int32_t getInt32() const
+    // Compact text of the value
+    std::string serialize() const
     {
-        return isNumber() ? dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->toInt32() : 0;
+        std::string s;
+        if (valid())
+            serialize(idx, s);
+        return s;
     }
-    inline int64_t getInt64() const
+
+private:
+    inline bool is(TapeDocument::Tag tag) const { return valid() && TapeDocument::tagOf(doc->tape[idx]) == tag; }
+    inline uint64_t bits() const { return isNumber() ? doc->tape[idx + 1] : 0; }
+
+    void serialize(size_t i, std::string& s) const
     {
-        return isNumber() ? dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->toInt64() : 0;
+        const TapeValue v(doc, i);
+        switch (TapeDocument::tagOf(doc->tape[i]))
+        {
+        case TapeDocument::TagNull:
+            s.append("null");
+            break;
+        case TapeDocument::TagTrue:
+            s.append("true");
+            break;
+        case TapeDocument::TagFalse:
+            s.append("false");
+            break;
+        case TapeDocument::TagInt64:
+            s.append(std::to_string(v.getInt64()));
+            break;
+        case TapeDocument::TagUint64:
+            s.append(std::to_string(v.getUint64()));
+            break;
+        case TapeDocument::TagDecimal:
+            s.append(IMPLEMENT::ValueNumber::formatDecimal(v.getDecimal()));
+            break;
+        case TapeDocument::TagString:
+            {
+                const char* p;
+                size_t n;
+                doc->string(i, p, n);
+                s.append("\"");
+                s.append(Utils::escape(p, n));
+                s.append("\"");
+            }
+            break;
+        case TapeDocument::TagStartObject:
+            s.append("{");
+            for (size_t j = i + 1, e = doc->next(i) - 1; j < e; j = doc->next(j))
+            {
+                if (j != i + 1)
+                    s.append(",");
+                serialize(j, s);
+                s.append(":");
+                j = doc->next(j);
+                serialize(j, s);
+            }
+            s.append("}");
+            break;
+        case TapeDocument::TagStartArray:
+            s.append("[");
+            for (size_t j = i + 1, e = doc->next(i) - 1; j < e; j = doc->next(j))
+            {
+                if (j != i + 1)
+                    s.append(",");
+                serialize(j, s);
+            }
+            s.append("]");
+            break;
+        default:
+            break;
+        }
     }
-    inline uint32_t getUint32() const
+
+private:
+    const TapeDocument* doc;
+    size_t idx;
+};
+
+inline TapeValue TapeDocument::root() const
+{
+    return valid() ? TapeValue(this, 0) : TapeValue();
+}
+
+// Field names of a type bound with JSONX_DEFINE(). Lookups are
+// case-insensitive like object keys, through a small open-addressing hash
+// table built once per type. The escaped keys are kept for writing.
+class FieldTable
+{
+public:
+    FieldTable(std::initializer_list<const char*> fieldNames)
+        : names(fieldNames)
     {
-        return isNumber() ? dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->toUint32() : 0;
+        size_t n = 4;
+        while (n < names.size() * 2)
+            n <<= 1;
+        slots.assign(n, 0);
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            lengths.push_back(strlen(names[i]));
+            keys.push_back("\"" + Utils::escape(names[i], lengths[i]) + "\":");
+            size_t h = hash(names[i], lengths[i]) & (n - 1);
+            while (0 != slots[h])
+                h = (h + 1) & (n - 1);
+            slots[h] = static_cast<uint32_t>(i + 1);
+        }
     }
-    inline uint64_t getUint64() const
+
+    inline size_t size() const { return names.size(); }
+    inline const char* name(size_t i) const { return names[i]; }
+    // "name": as written in JSON
+    inline const std::string& key(size_t i) const { return keys[i]; }
+
+    // Index of the field named s, size() if there is none
+    size_t find(const char* s, size_t n) const
     {
-        return isNumber() ? dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->toUint64() : 0;
+        const size_t mask = slots.size() - 1;
+        size_t h = hash(s, n) & mask;
+        while (0 != slots[h])
+        {
+            const size_t i = slots[h] - 1;
+            if (Utils::equal<char>(names[i], lengths[i], s, n, true))
+                return i;
+            h = (h + 1) & mask;
+        }
+        return names.size();
     }
-    inline double_t getDecimal() const
+
+private:
+    // FNV-1a of the ASCII lower case text
+    static size_t hash(const char* s, size_t n)
     {
-        return isNumber() ? dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->toDecimal() : 0.0;
+        uint64_t h = 0xCBF29CE484222325ULL;
+        for (size_t i = 0; i < n; ++i)
+        {
+            char c = s[i];
+            if (c >= 'A' && c <= 'Z')
+                c = static_cast<char>(c + ('a' - 'A'));
+            h ^= static_cast<uint8_t>(c);
+            h *= 0x100000001B3ULL;
+        }
+        return static_cast<size_t>(h ^ (h >> 32));
     }
 
-    inline void set(int32_t v) { if (isNumber()) dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->set(v); }
-    inline void set(int64_t v) { if (isNumber()) dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->set(v); }
-    inline void set(uint32_t v) { if (isNumber()) dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->set(v); }
-    inline void set(uint64_t v) { if (isNumber()) dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->set(v); }
-    inline void set(float_t v) { if (isNumber()) dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->set(v); }
-    inline void set(double_t v) { if (isNumber()) dynamic_cast<IMPLEMENT::ValueNumber*>(vp.get())->set(v); }
+private:
+    std::vector<const char*> names;
+    std::vector<size_t> lengths;
+    std::vector<std::string> keys;
+    std::vector<uint32_t> slots;
+};
 
-    inline std::string getString() const
+// Reads a document straight into C++ types, no Value is built (see
+// parseInto()). Bound types are read member by member through the functions
+// JSONX_DEFINE() generates, found by argument-dependent lookup.
+class StructReader : private IMPLEMENT::Parser
+{
+public:
+    StructReader(const char* s, size_t n, const ParseConfig* config = nullptr)
+        : IMPLEMENT::Parser(s, n, config), depth(0)
     {
-        return isString() ? dynamic_cast<IMPLEMENT::ValueString*>(vp.get())->get() : std::string();
     }
-    inline std::wstring getWstring() const
+    virtual ~StructReader() {}
+
+    using IMPLEMENT::Parser::getPos;
+    using IMPLEMENT::Parser::getError;
+    using IMPLEMENT::Parser::failed;
+
+    // One value into v, only whitespace may follow
+    template<typename T>
+    bool readDocument(T& v)
     {
-        return isString() ? dynamic_cast<IMPLEMENT::ValueString*>(vp.get())->getw() : std::wstring();
+        if (!read(v))
+            return false;
+        peekNextNotSpace();
+        if (!eof())
+        {
+            setError(JEUnexpectedChar);
+            return false;
+        }
+        return true;
     }
-    inline void set(const std::string& v) { if (isString()) dynamic_cast<IMPLEMENT::ValueString*>(vp.get())->set(v, false); }
-    inline void set(const std::wstring& v) { if (isString()) dynamic_cast<IMPLEMENT::ValueString*>(vp.get())->set(v, false); }
 
-    Value operator [](const std::string& key)
+    // A null leaves the target unchanged, except for std::optional
+    bool read(bool& v)
     {
-#ifdef _DEBUG
-        if (!isObject())
-            return Value();
-        else
-            return Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->get(key));
-#else
-        return isObject() ?Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->get(key)) : Value();
-#endif
+        switch (checkValueType())
+        {
+        case JsonNull:
+            return readNull();
+        case JsonBoolean:
+            return readBoolean(v);
+        default:
+            break;
+        }
+        return mismatch();
     }
 
-    const Value operator [](const std::string& key) const
+    // Integers must fit in T
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value, bool>::type read(T& v)
     {
-#ifdef _DEBUG
-        if (!isObject())
-            return Value();
-        else
-            return Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->get(key));
-#else
-        return isObject() ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->get(key)) : Value();
-#endif
+        IMPLEMENT::NumberToken num;
+        if (!readNumberOrNull(num))
+            return !failed();
+        if (IMPLEMENT::NumberToken::Int64 == num.type)
+        {
+            const bool fits = std::is_signed<T>::value
+                ? (num.i >= static_cast<int64_t>((std::numeric_limits<T>::min)()) && num.i <= static_cast<int64_t>((std::numeric_limits<T>::max)()))
+                : (num.i >= 0 && static_cast<uint64_t>(num.i) <= static_cast<uint64_t>((std::numeric_limits<T>::max)()));
+            if (fits)
+            {
+                v = static_cast<T>(num.i);
+                return true;
+            }
+        }
+        else if (IMPLEMENT::NumberToken::Uint64 == num.type && !std::is_signed<T>::value && num.u <= static_cast<uint64_t>((std::numeric_limits<T>::max)()))
+        {
+            v = static_cast<T>(num.u);
+            return true;
+        }
+        setError(JEMismatchValueType);
+        return false;
     }
 
-    Value set(const std::string& key, Value& v)
+    template<typename T>
+    typename std::enable_if<std::is_floating_point<T>::value, bool>::type read(T& v)
     {
-        return isObject()
-            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v.getPtr()))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        IMPLEMENT::NumberToken num;
+        if (!readNumberOrNull(num))
+            return !failed();
+        switch (num.type)
+        {
+        case IMPLEMENT::NumberToken::Int64:
+            v = static_cast<T>(num.i);
+            break;
+        case IMPLEMENT::NumberToken::Uint64:
+            v = static_cast<T>(num.u);
+            break;
+        default:
+            v = static_cast<T>(num.d);
+            break;
+        }
+        return true;
     }
-    Value set(const std::string& key, bool v)
+
+    bool read(std::string& v)
     {
-        return isObject()
-            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        switch (checkValueType())
+        {
+        case JsonNull:
+            return readNull();
+        case JsonString:
+            v.clear();
+            return readString(v);
+        default:
+            break;
+        }
+        return mismatch();
     }
-    Value set(const std::string& key, int32_t v)
+
+    bool read(std::wstring& v)
     {
-        return isObject()
-            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        std::string s;
+        switch (checkValueType())
+        {
+        case JsonNull:
+            return readNull();
+        case JsonString:
+            if (!readString(s))
+                return false;
+            v = Utils::toUtf16(s);
+            return true;
+        default:
+            break;
+        }
+        return mismatch();
     }
-    Value set(const std::string& key, uint32_t v)
+
+    // Any value, as a DOM
+    bool read(Value& v)
     {
-        return isObject()
-            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        IMPLEMENT::ValueBase* p = readValue();
+        if (nullptr == p)
+            return false;
+        v = Value(std::shared_ptr<IMPLEMENT::ValueBase>(p));
+        return true;
     }
-    Value set(const std::string& key, int64_t v)
+
+    // The elements replace the content of v
+    template<typename T, typename A>
+    bool read(std::vector<T, A>& v)
     {
-        return isObject()
-            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        switch (checkValueType())
+        {
+        case JsonNull:
+            return readNull();
+        case JsonArray:
+            break;
+        default:
+            return mismatch();
+        }
+        if (!checkDepth(depth))
+            return false;
+        readNext();
+        ++depth;
+        v.clear();
+        do {
+            const char c = peekNextNotSpace();
+            if (']' == c)
+            {
+                readNext();
+                --depth;
+                return true;
+            }
+            if (',' == c)
+            {
+                readNext();
+                continue;
+            }
+            T item = T();
+            if (!read(item))
+                return false;
+            v.push_back(std::move(item));
+        } while (true);
     }
-    Value set(const std::string& key, uint64_t v)
+
+#ifdef JSONX_HAS_OPTIONAL
+    template<typename T>
+    bool read(std::optional<T>& v)
     {
-        return isObject()
-            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        if (JsonNull == checkValueType())
+        {
+            v.reset();
+            return readNull();
+        }
+        if (!v)
+            v.emplace();
+        return read(*v);
     }
-    Value set(const std::string& key, double_t v)
+#endif
+
+    // A type bound with JSONX_DEFINE(). Members without a field are skipped,
+    // fields without a member keep their value. A key given twice: the last
+    // value wins.
+    template<typename T>
+    typename std::enable_if<std::is_class<T>::value, bool>::type read(T& v)
     {
-        return isObject()
-            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        switch (checkValueType())
+        {
+        case JsonNull:
+            return readNull();
+        case JsonObject:
+            break;
+        default:
+            return mismatch();
+        }
+        if (!checkDepth(depth))
+            return false;
+        readNext();
+        ++depth;
+        const FieldTable& fields = jsonxFields(static_cast<const T*>(nullptr));
+        do {
+            char c = peekNextNotSpace();
+            if ('}' == c)
+            {
+                readNext();
+                --depth;
+                return true;
+            }
+            if (',' == c)
+            {
+                readNext();
+                continue;
+            }
+            if ('\"' != c)
+            {
+                setError(eof() ? JEUnexpectedEnd : JEUnexpectedChar);
+                return false;
+            }
+
+            // The key is looked up before its value is read, the view may
+            // point to the scratch string
+            const char* key = nullptr;
+            size_t n = 0;
+            if (!readStringView(key, n))
+                return false;
+            const size_t field = fields.find(key, n);
+
+            c = peekNextNotSpace();
+            if (c != ':')
+            {
+                setError(eof() ? JEUnexpectedEnd : JEMissingColon);
+                return false;
+            }
+            readNext();
+            if (!jsonxReadField(*this, v, field))
+                return false;
+        } while (true);
     }
-    Value set(const std::string& key, const std::string& v)
+
+    // Value of a member which has no field
+    inline bool skip() { return skipValue(); }
+
+private:
+    // False without an error for a null
+    bool readNumberOrNull(IMPLEMENT::NumberToken& num)
     {
-        return isObject()
-            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        switch (checkValueType())
+        {
+        case JsonNull:
+            readNull();
+            return false;
+        case JsonNumber:
+            return readNumber(num);
+        default:
+            break;
+        }
+        return mismatch();
     }
-    Value set(const std::string& key, const std::wstring& v)
+
+    inline bool mismatch()
     {
-        return isObject()
-            ? Value(dynamic_cast<IMPLEMENT::ValueObject*>(vp.get())->set(key, v))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        setError(eof() ? JEUnexpectedEnd : JEMismatchValueType);
+        return false;
     }
 
-    Value operator [](size_t id)
+private:
+    // Open objects/arrays, checked against the maximum depth
+    size_t depth;
+};
+
+// Parse s straight into v: a type bound with JSONX_DEFINE(), a vector,
+// std::optional (C++17), a string, a number, a boolean or a Value. Returns
+// the error which stopped the parser, if any; v may be partly filled then.
+template<typename T>
+JsonError parseInto(const char* s, size_t n, T& v, const ParseConfig* config = nullptr)
+{
+    StructReader reader(s, n, config);
+    reader.readDocument(v);
+    return reader.getError();
+}
+
+template<typename T>
+JsonError parseInto(const std::string& s, T& v, const ParseConfig* config = nullptr)
+{
+    return parseInto(s.data(), s.size(), v, config);
+}
+
+// Writes C++ values as compact JSON into a sink, anything with
+// append(const char*, size_t) such as std::string (see serialize()). Bound
+// types are written field by field through the function JSONX_DEFINE()
+// generates; nothing is allocated besides what the sink does.
+template<typename Sink>
+class StructWriter
+{
+public:
+    explicit StructWriter(Sink& sink) : sink(sink) {}
+
+    void write(bool v)
     {
-#ifdef _DEBUG
-        if (!isArray())
-            return Value();
+        if (v)
+            sink.append("true", 4);
         else
-            return Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->get(id));
-#else
-        return isArray() ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->get(id)) : Value();
-#endif
+            sink.append("false", 5);
     }
 
-    const Value operator [](size_t id) const
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value, void>::type write(T v)
     {
-#ifdef _DEBUG
-        if (!isArray())
-            return Value();
-        else
-            return Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->get(id));
-#else
-        return isArray() ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->get(id)) : Value();
-#endif
+        // Digits are written backwards from the end of the buffer
+        char s[24];
+        char* end = s + sizeof(s);
+        char* p = end;
+        const bool minus = (v < 0);
+        uint64_t u = minus ? (0 - static_cast<uint64_t>(v)) : static_cast<uint64_t>(v);
+        do {
+            *--p = static_cast<char>('0' + (u % 10));
+            u /= 10;
+        } while (0 != u);
+        if (minus)
+            *--p = '-';
+        sink.append(p, static_cast<size_t>(end - p));
     }
 
-    Value push_back(Value& v)
+    template<typename T>
+    typename std::enable_if<std::is_floating_point<T>::value, void>::type write(T v)
     {
-        return isArray()
-            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v.getPtr()))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        char s[32];
+        sink.append(s, static_cast<size_t>(IMPLEMENT::ValueNumber::formatDecimal(static_cast<double>(v), s) - s));
     }
-    Value push_back(bool v)
+
+    void write(const std::string& v)
     {
-        return isArray()
-            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        sink.append("\"", 1);
+        Utils::escape(v.data(), v.size(), sink);
+        sink.append("\"", 1);
     }
-    Value push_back(int32_t v)
+
+    void write(const std::wstring& v)
     {
-        return isArray()
-            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        write(Utils::toUtf8(v));
     }
-    Value push_back(uint32_t v)
+
+    void write(const Value& v)
     {
-        return isArray()
-            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        const std::string& s = v.serialize();
+        sink.append(s.data(), s.size());
     }
-    Value push_back(int64_t v)
+
+    template<typename T, typename A>
+    void write(const std::vector<T, A>& v)
     {
-        return isArray()
-            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        sink.append("[", 1);
+        for (size_t i = 0; i < v.size(); ++i)
+        {
+            if (0 != i)
+                sink.append(",", 1);
+            write(static_cast<const T&>(v[i]));
+        }
+        sink.append("]", 1);
     }
-    Value push_back(uint64_t v)
+
+    // vector<bool> has no bool references
+    template<typename A>
+    void write(const std::vector<bool, A>& v)
     {
-        return isArray()
-            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        sink.append("[", 1);
+        for (size_t i = 0; i < v.size(); ++i)
+        {
+            if (0 != i)
+                sink.append(",", 1);
+            write(static_cast<bool>(v[i]));
+        }
+        sink.append("]", 1);
     }
-    Value push_back(double_t v)
+
+#ifdef JSONX_HAS_OPTIONAL
+    // An empty optional is written as null
+    template<typename T>
+    void write(const std::optional<T>& v)
     {
-        return isArray()
-            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        if (v)
+            write(*v);
+        else
+            sink.append("null", 4);
     }
-    Value push_back(const std::string& v)
+#endif
+
+    // A type bound with JSONX_DEFINE(), fields in declaration order
+    template<typename T>
+    typename std::enable_if<std::is_class<T>::value, void>::type write(const T& v)
     {
-        return isArray()
-            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        sink.append("{", 1);
+        jsonxWriteFields(*this, v);
+        sink.append("}", 1);
     }
-    Value push_back(const std::wstring& v)
+
+    // One member of a bound type: the escaped key is precomputed
+    template<typename T>
+    void field(const FieldTable& fields, size_t i, const T& v)
     {
-        return isArray()
-            ? Value(dynamic_cast<IMPLEMENT::ValueArray*>(vp.get())->push_back(v))
-            : Value(std::shared_ptr<IMPLEMENT::ValueBase>());
+        if (0 != i)
+            sink.append(",", 1);
+        const std::string& key = fields.key(i);
+        sink.append(key.data(), key.size());
+        write(v);
     }
 
-protected:
-    std::shared_ptr<IMPLEMENT::ValueBase> getPtr() { return vp; }
-
 private:
-    std::shared_ptr<IMPLEMENT::ValueBase> vp;
+    Sink& sink;
 };
 
+// Write v as compact JSON into sink: a type bound with JSONX_DEFINE(), a
+// vector, std::optional (C++17), a string, a number, a boolean or a Value.
+// The output is the same as serialize() of the equivalent Value with the
+// members in field order.
+template<typename T, typename Sink>
+void serialize(const T& v, Sink& sink)
+{
+    StructWriter<Sink> writer(sink);
+    writer.write(v);
+}
+
+template<typename T>
+std::string serialize(const T& v)
+{
+    std::string s;
+    serialize(v, s);
+    return s;
+}
+
 }   // namespace JSONX
 
+// Struct binding: the public fields of a type are mapped to object members of
+// the same name, e.g.
+//
+//     namespace app {
+//     struct Point { int64_t x; int64_t y; std::vector<std::string> tags; };
+//     JSONX_DEFINE(Point, x, y, tags)
+//     }
+//
+// Use it in the namespace of the type, at namespace scope. Members are
+// matched to fields through a hash table and a switch on the field index;
+// serialize() writes the fields in order.
+#define JSONX_PP_EXPAND(x) x
+#define JSONX_PP_CAT(a, b) JSONX_PP_CAT_(a, b)
+#define JSONX_PP_CAT_(a, b) a##b
+#define JSONX_PP_COUNT(...) JSONX_PP_EXPAND(JSONX_PP_COUNT_(__VA_ARGS__, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1))
+#define JSONX_PP_COUNT_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, n, ...) n
+// m(t, i, field) for each field, i counting from 0 (up to 32 fields)
+#define JSONX_PP_EACH(m, t, ...) JSONX_PP_EXPAND(JSONX_PP_CAT(JSONX_PP_EACH_, JSONX_PP_COUNT(__VA_ARGS__))(m, t, JSONX_PP_COUNT(__VA_ARGS__), __VA_ARGS__))
+#define JSONX_PP_EACH_1(m, t, n, f) m(t, (n - 1), f)
+#define JSONX_PP_EACH_2(m, t, n, f, ...) m(t, (n - 2), f) JSONX_PP_EXPAND(JSONX_PP_EACH_1(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_3(m, t, n, f, ...) m(t, (n - 3), f) JSONX_PP_EXPAND(JSONX_PP_EACH_2(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_4(m, t, n, f, ...) m(t, (n - 4), f) JSONX_PP_EXPAND(JSONX_PP_EACH_3(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_5(m, t, n, f, ...) m(t, (n - 5), f) JSONX_PP_EXPAND(JSONX_PP_EACH_4(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_6(m, t, n, f, ...) m(t, (n - 6), f) JSONX_PP_EXPAND(JSONX_PP_EACH_5(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_7(m, t, n, f, ...) m(t, (n - 7), f) JSONX_PP_EXPAND(JSONX_PP_EACH_6(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_8(m, t, n, f, ...) m(t, (n - 8), f) JSONX_PP_EXPAND(JSONX_PP_EACH_7(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_9(m, t, n, f, ...) m(t, (n - 9), f) JSONX_PP_EXPAND(JSONX_PP_EACH_8(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_10(m, t, n, f, ...) m(t, (n - 10), f) JSONX_PP_EXPAND(JSONX_PP_EACH_9(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_11(m, t, n, f, ...) m(t, (n - 11), f) JSONX_PP_EXPAND(JSONX_PP_EACH_10(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_12(m, t, n, f, ...) m(t, (n - 12), f) JSONX_PP_EXPAND(JSONX_PP_EACH_11(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_13(m, t, n, f, ...) m(t, (n - 13), f) JSONX_PP_EXPAND(JSONX_PP_EACH_12(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_14(m, t, n, f, ...) m(t, (n - 14), f) JSONX_PP_EXPAND(JSONX_PP_EACH_13(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_15(m, t, n, f, ...) m(t, (n - 15), f) JSONX_PP_EXPAND(JSONX_PP_EACH_14(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_16(m, t, n, f, ...) m(t, (n - 16), f) JSONX_PP_EXPAND(JSONX_PP_EACH_15(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_17(m, t, n, f, ...) m(t, (n - 17), f) JSONX_PP_EXPAND(JSONX_PP_EACH_16(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_18(m, t, n, f, ...) m(t, (n - 18), f) JSONX_PP_EXPAND(JSONX_PP_EACH_17(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_19(m, t, n, f, ...) m(t, (n - 19), f) JSONX_PP_EXPAND(JSONX_PP_EACH_18(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_20(m, t, n, f, ...) m(t, (n - 20), f) JSONX_PP_EXPAND(JSONX_PP_EACH_19(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_21(m, t, n, f, ...) m(t, (n - 21), f) JSONX_PP_EXPAND(JSONX_PP_EACH_20(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_22(m, t, n, f, ...) m(t, (n - 22), f) JSONX_PP_EXPAND(JSONX_PP_EACH_21(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_23(m, t, n, f, ...) m(t, (n - 23), f) JSONX_PP_EXPAND(JSONX_PP_EACH_22(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_24(m, t, n, f, ...) m(t, (n - 24), f) JSONX_PP_EXPAND(JSONX_PP_EACH_23(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_25(m, t, n, f, ...) m(t, (n - 25), f) JSONX_PP_EXPAND(JSONX_PP_EACH_24(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_26(m, t, n, f, ...) m(t, (n - 26), f) JSONX_PP_EXPAND(JSONX_PP_EACH_25(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_27(m, t, n, f, ...) m(t, (n - 27), f) JSONX_PP_EXPAND(JSONX_PP_EACH_26(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_28(m, t, n, f, ...) m(t, (n - 28), f) JSONX_PP_EXPAND(JSONX_PP_EACH_27(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_29(m, t, n, f, ...) m(t, (n - 29), f) JSONX_PP_EXPAND(JSONX_PP_EACH_28(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_30(m, t, n, f, ...) m(t, (n - 30), f) JSONX_PP_EXPAND(JSONX_PP_EACH_29(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_31(m, t, n, f, ...) m(t, (n - 31), f) JSONX_PP_EXPAND(JSONX_PP_EACH_30(m, t, n, __VA_ARGS__))
+#define JSONX_PP_EACH_32(m, t, n, f, ...) m(t, (n - 32), f) JSONX_PP_EXPAND(JSONX_PP_EACH_31(m, t, n, __VA_ARGS__))
+
+#define JSONX_PP_FIELD_NAME(t, i, f) #f,
+#define JSONX_PP_FIELD_READ(t, i, f) case i: return reader.read(v.f);
+#define JSONX_PP_FIELD_WRITE(t, i, f) writer.field(fields, i, v.f);
+
+#define JSONX_DEFINE(Type, ...) \
+    inline const ::JSONX::FieldTable& jsonxFields(const Type*) \
+    { \
+        static const ::JSONX::FieldTable fields({ JSONX_PP_EACH(JSONX_PP_FIELD_NAME, Type, __VA_ARGS__) }); \
+        return fields; \
+    } \
+    template<typename Reader> \
+    inline bool jsonxReadField(Reader& reader, Type& v, size_t field) \
+    { \
+        switch (field) \
+        { \
+        JSONX_PP_EACH(JSONX_PP_FIELD_READ, Type, __VA_ARGS__) \
+        default: \
+            break; \
+        } \
+        return reader.skip(); \
+    } \
+    template<typename Writer> \
+    inline void jsonxWriteFields(Writer& writer, const Type& v) \
+    { \
+        const ::JSONX::FieldTable& fields = jsonxFields(&v); \
+        JSONX_PP_EACH(JSONX_PP_FIELD_WRITE, Type, __VA_ARGS__) \
+    }
+
 #endif
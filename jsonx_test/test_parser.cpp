@@ -113,6 +113,47 @@ BOOST_AUTO_TEST_CASE(CheckNumber)
     BOOST_CHECK(sp != nullptr && sp->isNumber() && sp->isDecimal() && !sp->isSigned());
 }
 
+BOOST_AUTO_TEST_CASE(CheckNumberRange)
+{
+    JSONX::Value val = JSONX::Value::parse("[18446744073709551615, -9223372036854775808, 9223372036854775807, 18446744073709551616]");
+    BOOST_CHECK(val.isArray() && val.size() == 4);
+    BOOST_CHECK(val[0].isIntegerNumber() && !val[0].isSignedNumber());
+    BOOST_CHECK_EQUAL(val[0].getUint64(), 18446744073709551615ULL);
+    BOOST_CHECK(val[1].isIntegerNumber() && val[1].isSignedNumber());
+    BOOST_CHECK_EQUAL(val[1].getInt64(), INT64_MIN);
+    BOOST_CHECK_EQUAL(val[2].getInt64(), INT64_MAX);
+    BOOST_CHECK(val[3].isDecimalNumber());
+    const std::string& s = val.serialize();
+    BOOST_CHECK_EQUAL(s.substr(0, 63), "[18446744073709551615,-9223372036854775808,9223372036854775807,");
+    BOOST_CHECK(JSONX::Value::parse(s)[3].isDecimalNumber());
+
+    // Decimals round-trip exactly
+    val = JSONX::Value::parse("[0.1, 1e-7, -2.5E+300, 123456789.123456789, 1.0, 4.9e-324]");
+    BOOST_CHECK(val.isArray() && val.size() == 6);
+    BOOST_CHECK_EQUAL(val[0].getDecimal(), 0.1);
+    BOOST_CHECK_EQUAL(val[1].getDecimal(), 1e-7);
+    BOOST_CHECK_EQUAL(val[2].getDecimal(), -2.5E+300);
+    BOOST_CHECK_EQUAL(val[3].getDecimal(), 123456789.123456789);
+    BOOST_CHECK(val[4].isDecimalNumber());
+    BOOST_CHECK_EQUAL(val[5].getDecimal(), 4.9e-324);
+    const JSONX::Value& val2 = JSONX::Value::parse(val.serialize());
+    for (size_t i = 0; i < val.size(); ++i)
+        BOOST_CHECK_EQUAL(val2[i].getDecimal(), val[i].getDecimal());
+    BOOST_CHECK(val2[4].isDecimalNumber());
+
+    // Underflow goes to zero, overflow fails
+    val = JSONX::Value::parse("1e-400");
+    BOOST_CHECK(val.isDecimalNumber() && val.getDecimal() == 0.0);
+    BOOST_CHECK(!JSONX::Value::parse("1e400").valid());
+
+    // Invalid numbers
+    BOOST_CHECK(!JSONX::Value::parse("-").valid());
+    BOOST_CHECK(!JSONX::Value::parse("[01]").valid());
+    BOOST_CHECK(!JSONX::Value::parse("1.").valid());
+    BOOST_CHECK(!JSONX::Value::parse("[1.e5]").valid());
+    BOOST_CHECK(!JSONX::Value::parse("1e+").valid());
+}
+
 BOOST_AUTO_TEST_CASE(CheckString)
 {
     JSONX::IMPLEMENT::StringParser<char> parser("\"\"");
@@ -143,6 +184,32 @@ BOOST_AUTO_TEST_CASE(CheckString)
     BOOST_CHECK(sp != nullptr && sp->isString() && sp->get() == std::string("Hello \"World\"!"));
 }
 
+BOOST_AUTO_TEST_CASE(CheckStringEscape)
+{
+    // Escapes, including UTF-16 surrogate pairs, are decoded to UTF-8
+    JSONX::Value val = JSONX::Value::parse("\"caf\\u00e9 \\ud83d\\ude00 \\u4e2d\\t\\/\"");
+    BOOST_CHECK(val.isString());
+    BOOST_CHECK_EQUAL(val.getString(), "caf\xC3\xA9 \xF0\x9F\x98\x80 \xE4\xB8\xAD\t/");
+
+    // Long runs with escapes near the end
+    const std::string sLong(100, 'x');
+    val = JSONX::Value::parse("[\"" + sLong + "\\n" + sLong + "\\\"\"]");
+    BOOST_CHECK(val.isArray());
+    BOOST_CHECK_EQUAL(val[0].getString(), sLong + "\n" + sLong + "\"");
+
+    // Keys are decoded once
+    val = JSONX::Value::parse("{\"a\\\\u0041\":1}");
+    BOOST_CHECK(val.isObject());
+    BOOST_CHECK_EQUAL(val["a\\u0041"].getInt32(), 1);
+
+    // Invalid strings
+    BOOST_CHECK(!JSONX::Value::parse("\"a\nb\"").valid());
+    BOOST_CHECK(!JSONX::Value::parse("\"\\x\"").valid());
+    BOOST_CHECK(!JSONX::Value::parse("\"\\u12\"").valid());
+    BOOST_CHECK(!JSONX::Value::parse("\"\\ud83d\"").valid());
+    BOOST_CHECK(!JSONX::Value::parse("\"abc").valid());
+}
+
 BOOST_AUTO_TEST_CASE(CheckObject)
 {
     JSONX::IMPLEMENT::StringParser<char> parser("{}");
@@ -418,6 +485,1377 @@ BOOST_AUTO_TEST_CASE(CheckValueParserW)
     checkJson1(val);
 }
 
+BOOST_AUTO_TEST_CASE(CheckValueParserBuffer)
+{
+    const std::string sJson1(json1);
+    const JSONX::Value& val = JSONX::Value::parse(sJson1.data(), sJson1.size());
+    checkJson1(val);
+
+    // Buffer is not null-terminated and followed by garbage
+    const std::string s("[1,2,3]]]]");
+    const JSONX::Value& val2 = JSONX::Value::parse(s.data(), 7);
+    BOOST_CHECK(val2.isArray());
+    BOOST_CHECK_EQUAL(val2.size(), 3);
+
+    // Truncated input
+    const JSONX::Value& val3 = JSONX::Value::parse(s.data(), 4);
+    BOOST_CHECK(!val3.valid());
+}
+
+BOOST_AUTO_TEST_CASE(CheckValueParserInSitu)
+{
+    std::string sJson1(json1);
+    const JSONX::Value& val = JSONX::Value::parseInSitu(&sJson1[0], sJson1.size());
+    checkJson1(val);
+
+    // Strings and keys are decoded in place and refer to the buffer
+    char s[] = "{\"k\\u00e9y\" : [\"a\\\"b\", \"\\ud83d\\ude00 end\"], \"n\" : 1}";
+    const JSONX::Value& val2 = JSONX::Value::parseInSitu(s, sizeof(s) - 1);
+    BOOST_CHECK(val2.isObject());
+    BOOST_CHECK_EQUAL(val2.size(), 2);
+    BOOST_CHECK_EQUAL(val2["n"].getInt32(), 1);
+    const JSONX::Value& arr = val2["k\xC3\xA9y"];
+    BOOST_CHECK(arr.isArray());
+    BOOST_CHECK_EQUAL(arr[0].getString(), "a\"b");
+    BOOST_CHECK_EQUAL(arr[1].getString(), "\xF0\x9F\x98\x80 end");
+    BOOST_CHECK_EQUAL(std::string(s + 2, 4), "k\xC3\xA9y");
+
+    // The document owns the buffer
+    JSONX::Value item;
+    {
+        const JSONX::Value& val3 = JSONX::Value::parseInSitu(std::string("{\"a\":[\"x\\ty\"]}"));
+        item = val3["a"];
+    }
+    BOOST_CHECK_EQUAL(item[0].getString(), "x\ty");
+    BOOST_CHECK_EQUAL(item.serialize(), "[\"x\\ty\"]");
+
+    char s4[] = "[\"abc";
+    BOOST_CHECK(!JSONX::Value::parseInSitu(s4, sizeof(s4) - 1).valid());
+}
+
+BOOST_AUTO_TEST_CASE(CheckStructuralIndex)
+{
+    const std::string s("{ \"a\\\"[\" : [ -12,true ] }");
+    JSONX::IMPLEMENT::StructuralIndex index;
+    BOOST_CHECK(index.build(s.data(), s.size()));
+    const uint32_t expected[] = { 0, 2, 9, 11, 13, 16, 17, 22, 24 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(index.data(), index.data() + index.size(), expected, expected + 9);
+
+    // Long enough to span several 64-byte blocks
+    std::string s2(json1);
+    s2 = s2 + " " + s2;
+    BOOST_CHECK(index.build(s2.data(), s2.size()));
+    BOOST_CHECK(!index.empty());
+
+    JSONX::ParseConfig config;
+    config.setStructuralIndex(true);
+    const JSONX::Value& val = JSONX::Value::parse(json1, &config);
+    checkJson1(val);
+
+    const JSONX::Value& val2 = JSONX::Value::parse("[1 x]", &config);
+    BOOST_CHECK(!val2.valid());
+}
+
+// Records SAX events as text
+class EventRecorder
+{
+public:
+    bool null() { s.append("n "); return true; }
+    bool boolean(bool v) { s.append(v ? "t " : "f "); return true; }
+    bool int64(int64_t v) { s.append("i:" + std::to_string(v) + " "); return true; }
+    bool uint64(uint64_t v) { s.append("u:" + std::to_string(v) + " "); return true; }
+    bool decimal(double v) { s.append("d:" + std::to_string(v) + " "); return true; }
+    bool string(const char* p, size_t n) { s.append("s:").append(p, n).append(" "); return true; }
+    bool startObject() { s.append("{ "); return true; }
+    bool key(const char* p, size_t n) { s.append("k:").append(p, n).append(" "); return (std::string(p, n) != "stop"); }
+    bool endObject(size_t count) { s.append("}" + std::to_string(count) + " "); return true; }
+    bool startArray() { s.append("[ "); return true; }
+    bool endArray(size_t count) { s.append("]" + std::to_string(count) + " "); return true; }
+
+    std::string s;
+};
+
+// Only counts strings
+class StringCounter : public JSONX::BaseHandler
+{
+public:
+    StringCounter() : count(0) {}
+    bool string(const char* p, size_t n) { (void)p; (void)n; ++count; return true; }
+
+    size_t count;
+};
+
+BOOST_AUTO_TEST_CASE(CheckSaxHandler)
+{
+    const std::string s("{\"a\" : [null, true, false, -1, 18446744073709551615, 1.5, \"x\\\"y\"], \"k\\u00e9\" : {}, \"e\" : []}");
+    EventRecorder rec;
+    BOOST_CHECK_EQUAL(JSONX::parse(s, rec), JSONX::JESuccess);
+    BOOST_CHECK_EQUAL(rec.s, "{ k:a [ n t f i:-1 u:18446744073709551615 d:1.500000 s:x\"y ]7 k:k\xC3\xA9 { }0 k:e [ ]0 }3 ");
+
+    // In place
+    std::string s2(s);
+    EventRecorder rec2;
+    BOOST_CHECK_EQUAL(JSONX::parseInSitu(&s2[0], s2.size(), rec2), JSONX::JESuccess);
+    BOOST_CHECK_EQUAL(rec2.s, rec.s);
+
+    // With structural index
+    JSONX::ParseConfig pc;
+    pc.setStructuralIndex(true);
+    EventRecorder rec3;
+    BOOST_CHECK_EQUAL(JSONX::parse(s, rec3, &pc), JSONX::JESuccess);
+    BOOST_CHECK_EQUAL(rec3.s, rec.s);
+
+    StringCounter counter;
+    BOOST_CHECK_EQUAL(JSONX::parse(std::string(json1), counter), JSONX::JESuccess);
+    BOOST_CHECK_EQUAL(counter.count, 24);
+
+    // Stopped by the handler
+    EventRecorder rec4;
+    BOOST_CHECK_EQUAL(JSONX::parse(std::string("{\"a\":1,\"stop\":2,\"b\":3}"), rec4), JSONX::JEAborted);
+    BOOST_CHECK_EQUAL(rec4.s, "{ k:a i:1 k:stop ");
+
+    EventRecorder rec5;
+    BOOST_CHECK_EQUAL(JSONX::parse(std::string("[1, \"a"), rec5), JSONX::JEUnexpectedEnd);
+    BOOST_CHECK_EQUAL(JSONX::parse(std::string("{\"a\" 1}"), rec5), JSONX::JEMissingColon);
+}
+
+BOOST_AUTO_TEST_CASE(CheckJsonReader)
+{
+    const std::string s("{\"id\" : 7, \"skip\" : {\"a\" : [1, {\"b\" : \"]\"}]}, \"tags\" : [\"x\\ty\", true, null, -2.5], \"n\" : 18446744073709551615}");
+    JSONX::JsonReader reader(s.data(), s.size());
+    BOOST_CHECK(reader.enterObject());
+    BOOST_CHECK_EQUAL(reader.depth(), 1);
+
+    BOOST_CHECK(reader.next() && reader.tokenType() == JSONX::TokenKey && reader.equals("id"));
+    BOOST_CHECK(reader.next() && reader.tokenType() == JSONX::TokenNumber);
+    BOOST_CHECK(reader.isIntegerNumber());
+    BOOST_CHECK_EQUAL(reader.getInt64(), 7);
+
+    // Skip a whole member
+    BOOST_CHECK(reader.skipValue());
+    BOOST_CHECK_EQUAL(reader.tokenType(), JSONX::TokenEndObject);
+    BOOST_CHECK_EQUAL(reader.depth(), 1);
+
+    BOOST_CHECK(reader.next() && reader.equals("tags"));
+    BOOST_CHECK(reader.enterArray());
+    BOOST_CHECK(reader.next() && reader.tokenType() == JSONX::TokenString);
+    const char* p = nullptr;
+    size_t n = 0;
+    BOOST_CHECK(reader.getStringView(p, n));
+    BOOST_CHECK_EQUAL(std::string(p, n), "x\ty");
+    BOOST_CHECK(reader.next() && reader.tokenType() == JSONX::TokenBoolean && reader.getBoolean());
+    BOOST_CHECK(reader.next() && reader.tokenType() == JSONX::TokenNull);
+    BOOST_CHECK(reader.next() && reader.tokenType() == JSONX::TokenNumber);
+    BOOST_CHECK_EQUAL(reader.getDecimal(), -2.5);
+    BOOST_CHECK(reader.next() && reader.tokenType() == JSONX::TokenEndArray);
+
+    BOOST_CHECK(reader.next() && reader.tokenType() == JSONX::TokenKey && reader.getString() == "n");
+    BOOST_CHECK(reader.next() && reader.getUint64() == 18446744073709551615ULL);
+    BOOST_CHECK(reader.next() && reader.tokenType() == JSONX::TokenEndObject);
+    BOOST_CHECK_EQUAL(reader.depth(), 0);
+
+    // Done
+    BOOST_CHECK(!reader.next());
+    BOOST_CHECK(!reader.failed());
+    BOOST_CHECK_EQUAL(reader.tokenType(), JSONX::TokenNone);
+
+    // Wrong layout
+    JSONX::JsonReader reader2(s.data(), s.size());
+    BOOST_CHECK(!reader2.enterArray());
+    BOOST_CHECK_EQUAL(reader2.getError(), JSONX::JEMismatchValueType);
+
+    // Truncated
+    JSONX::JsonReader reader3(s.data(), 30);
+    while (reader3.next())
+        ;
+    BOOST_CHECK_EQUAL(reader3.getError(), JSONX::JEUnexpectedEnd);
+
+    // With structural index
+    JSONX::ParseConfig pc;
+    pc.setStructuralIndex(true);
+    JSONX::JsonReader reader4(json1, strlen(json1), &pc);
+    size_t keys = 0;
+    while (reader4.next())
+    {
+        if (reader4.tokenType() == JSONX::TokenKey)
+            ++keys;
+    }
+    BOOST_CHECK(!reader4.failed());
+    BOOST_CHECK_EQUAL(keys, 34);
+}
+
+// Feed s in chunks of the given size, returns the serialized documents
+static std::vector<std::string> feedChunks(const std::string& s, size_t chunk, JSONX::JsonError& error, const JSONX::ParseConfig* config = nullptr)
+{
+    std::vector<std::string> docs;
+    JSONX::PushParser parser(config);
+    for (size_t pos = 0; pos < s.size(); pos += chunk)
+    {
+        const char* p = s.data() + pos;
+        size_t n = (s.size() - pos < chunk) ? (s.size() - pos) : chunk;
+        while (n != 0)
+        {
+            const JSONX::FeedStatus status = parser.feed(p, n);
+            p += parser.consumed();
+            n -= parser.consumed();
+            if (status == JSONX::FeedError)
+            {
+                error = parser.getError();
+                return docs;
+            }
+            if (status == JSONX::ValueComplete)
+                docs.push_back(parser.value().serialize());
+        }
+    }
+    if (parser.finish() == JSONX::ValueComplete)
+        docs.push_back(parser.value().serialize());
+    error = parser.getError();
+    return docs;
+}
+
+BOOST_AUTO_TEST_CASE(CheckPushParser)
+{
+    const std::string sJson1(json1);
+    const std::string expected = JSONX::Value::parse(sJson1).serialize();
+    for (size_t chunk = 1; chunk <= 64; ++chunk)
+    {
+        JSONX::JsonError error = JSONX::JESuccess;
+        const std::vector<std::string>& docs = feedChunks(sJson1, chunk, error);
+        BOOST_CHECK_EQUAL(error, JSONX::JESuccess);
+        BOOST_CHECK(docs.size() == 1 && docs[0] == expected);
+    }
+
+    // Documents without separator, escapes and numbers split anywhere
+    const std::string s("{\"k\\u00e9\":[\"a\\\"b\\ud83d\\ude00\",-1.5e3,true]}[null,false]\"x\"true\"y\" 123 -7");
+    for (size_t chunk = 1; chunk <= s.size(); ++chunk)
+    {
+        JSONX::JsonError error = JSONX::JESuccess;
+        const std::vector<std::string>& docs = feedChunks(s, chunk, error);
+        BOOST_CHECK_EQUAL(error, JSONX::JESuccess);
+        BOOST_REQUIRE_EQUAL(docs.size(), 7);
+        BOOST_CHECK_EQUAL(docs[0], "{\"k\xC3\xA9\":[\"a\\\"b\xF0\x9F\x98\x80\",-1500.0,true]}");
+        BOOST_CHECK_EQUAL(docs[1], "[null,false]");
+        BOOST_CHECK_EQUAL(docs[2], "\"x\"");
+        BOOST_CHECK_EQUAL(docs[3], "true");
+        BOOST_CHECK_EQUAL(docs[4], "\"y\"");
+        BOOST_CHECK_EQUAL(docs[5], "123");
+        BOOST_CHECK_EQUAL(docs[6], "-7");
+    }
+
+    JSONX::JsonError error = JSONX::JESuccess;
+    feedChunks("[1, tru]", 3, error);
+    BOOST_CHECK_EQUAL(error, JSONX::JEUnexpectedChar);
+    feedChunks("{\"a\" 1}", 2, error);
+    BOOST_CHECK_EQUAL(error, JSONX::JEMissingColon);
+    feedChunks("[1, \"ab", 2, error);
+    BOOST_CHECK_EQUAL(error, JSONX::JEUnexpectedEnd);
+}
+
+class LineCounter : public JSONX::BaseHandler
+{
+public:
+    LineCounter() : keys(0) {}
+    bool key(const char* s, size_t n) { (void)s; (void)n; ++keys; return true; }
+
+    size_t keys;
+};
+
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+// Runs out after limit bytes, thread-safe, keeps the peak usage
+class LimitedResource : public std::pmr::memory_resource
+{
+public:
+    explicit LimitedResource(size_t n) : limit(n), used(0), peak(0) {}
+
+    size_t getPeak() { std::lock_guard<std::mutex> lock(m); return peak; }
+    size_t getUsed() { std::lock_guard<std::mutex> lock(m); return used; }
+
+private:
+    void* do_allocate(size_t n, size_t align) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            if (used + n > limit)
+                throw std::bad_alloc();
+            used += n;
+            if (used > peak)
+                peak = used;
+        }
+        return std::pmr::new_delete_resource()->allocate(n, align);
+    }
+    void do_deallocate(void* p, size_t n, size_t align) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            used -= n;
+        }
+        std::pmr::new_delete_resource()->deallocate(p, n, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& rhs) const noexcept override { return this == &rhs; }
+
+    size_t limit;
+    size_t used;
+    size_t peak;
+    std::mutex m;
+};
+#endif
+
+BOOST_AUTO_TEST_CASE(CheckJsonLinesReader)
+{
+    std::string s;
+    const size_t lines = 20000;
+    for (size_t i = 0; i < lines; ++i)
+    {
+        s.append("{\"id\":" + std::to_string(i) + ",\"name\":\"line\\t" + std::to_string(i) + "\"}\r\n");
+        if (0 == i % 1000)
+            s.append(" \n\n");
+    }
+
+    // One by one
+    JSONX::JsonLinesReader reader(s.data(), s.size());
+    JSONX::Value v;
+    size_t count = 0;
+    bool ok = true;
+    while (reader.next(v))
+    {
+        ok = ok && v.isObject() && v["id"].getUint64() == count && v["name"].getString() == "line\t" + std::to_string(count);
+        ++count;
+    }
+    BOOST_CHECK(ok);
+    BOOST_CHECK_EQUAL(count, lines);
+    BOOST_CHECK(reader.eof());
+
+    // Events
+    JSONX::JsonLinesReader reader2(s.data(), s.size());
+    LineCounter counter;
+    JSONX::JsonError e = JSONX::JESuccess;
+    while (reader2.next(counter, e) && e == JSONX::JESuccess)
+        ;
+    BOOST_CHECK_EQUAL(e, JSONX::JESuccess);
+    BOOST_CHECK_EQUAL(counter.keys, 2 * lines);
+
+    // Ordered, on 4 threads
+    JSONX::JsonLinesReader reader3(s.data(), s.size());
+    std::vector<uint64_t> ids;
+    BOOST_CHECK_EQUAL(reader3.parse([&](const JSONX::Value& v) { ids.push_back(v["id"].getUint64()); }, 4, true), lines);
+    ok = (ids.size() == lines);
+    for (size_t i = 0; ok && i < ids.size(); ++i)
+        ok = (ids[i] == i);
+    BOOST_CHECK(ok);
+
+    // Unordered
+    JSONX::JsonLinesReader reader4(s.data(), s.size());
+    ids.clear();
+    BOOST_CHECK_EQUAL(reader4.parse([&](const JSONX::Value& v) { ids.push_back(v["id"].getUint64()); }, 4, false), lines);
+    std::sort(ids.begin(), ids.end());
+    ok = (ids.size() == lines);
+    for (size_t i = 0; ok && i < ids.size(); ++i)
+        ok = (ids[i] == i);
+    BOOST_CHECK(ok);
+
+    // Malformed lines are passed as invalid values
+    const std::string s2("[1]\n{\"a\"\n\"x\"\n");
+    JSONX::JsonLinesReader reader5(s2.data(), s2.size());
+    std::vector<bool> valid;
+    BOOST_CHECK_EQUAL(reader5.parse([&](const JSONX::Value& v) { valid.push_back(v.valid()); }), 3);
+    BOOST_CHECK(valid.size() == 3 && valid[0] && !valid[1] && valid[2]);
+
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    // A slow callback doesn't leave the whole input parsed ahead of it
+    std::string s3;
+    for (size_t i = 0; i < 10; ++i)
+        s3.append(s);
+    JSONX::ParseConfig lpc;
+    LimitedResource all(static_cast<size_t>(-1));
+    lpc.setMemoryResource(&all);
+    {
+        std::vector<JSONX::Value> values;
+        JSONX::JsonLinesReader reader6(s3.data(), s3.size(), &lpc);
+        while (reader6.next(v))
+            values.push_back(v);
+    }
+    const size_t total = all.getPeak();
+    LimitedResource ahead(static_cast<size_t>(-1));
+    lpc.setMemoryResource(&ahead);
+    JSONX::JsonLinesReader reader7(s3.data(), s3.size(), &lpc);
+    count = 0;
+    BOOST_CHECK_EQUAL(reader7.parse([&](const JSONX::Value&) {
+        if (0 == count++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }, 4), 10 * lines);
+    BOOST_CHECK_LT(ahead.getPeak(), total / 2);
+    BOOST_CHECK_EQUAL(ahead.getUsed(), 0);
+
+    // An exception of a worker is thrown on the calling thread
+    LimitedResource limited(65536);
+    lpc.setMemoryResource(&limited);
+    JSONX::JsonLinesReader reader8(s3.data(), s3.size(), &lpc);
+    BOOST_CHECK_THROW(reader8.parse([](const JSONX::Value&) {}, 4), std::bad_alloc);
+    JSONX::JsonLinesReader reader9(s3.data(), s3.size(), &lpc);
+    BOOST_CHECK_THROW(reader9.parse([](const JSONX::Value&) {}, 4, false), std::bad_alloc);
+    BOOST_CHECK_EQUAL(limited.getUsed(), 0);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(CheckParallelArray)
+{
+    // Quoted brackets and commas must not split elements
+    std::string s(" [");
+    const size_t count = 30000;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (0 != i)
+            s.append(i % 7 ? ",\n" : " , ");
+        s.append("{\"id\":" + std::to_string(i) + ",\"s\":\"a],[\\\"b\\\\\",\"list\":[1,{\"x\":\"}\"},[]]}");
+    }
+    s.append("]\n");
+    BOOST_CHECK(s.size() > 1048576);
+
+    const std::string expected = JSONX::Value::parse(s).serialize();
+    JSONX::ParseConfig pc;
+    pc.setThreads(4);
+    const JSONX::Value& val = JSONX::Value::parse(s, &pc);
+    BOOST_CHECK(val.isArray());
+    BOOST_CHECK_EQUAL(val.size(), count);
+    BOOST_CHECK_EQUAL(val[count - 1]["id"].getUint64(), count - 1);
+    BOOST_CHECK_EQUAL(val[5]["s"].getString(), "a],[\"b\\");
+    BOOST_CHECK(val.serialize() == expected);
+
+    std::string s2(s);
+    const JSONX::Value& val2 = JSONX::Value::parseInSitu(std::move(s2), &pc);
+    BOOST_CHECK(val2.serialize() == expected);
+
+    // Malformed
+    std::string s3(s);
+    s3[s3.size() - 2] = ' ';
+    BOOST_CHECK(!JSONX::Value::parse(s3, &pc).valid());
+    std::string s4(s);
+    s4.insert(s4.find("\"id\":", s4.size() / 2) + 5, "@");
+    BOOST_CHECK(!JSONX::Value::parse(s4, &pc).valid());
+    std::string s5(s);
+    s5[s5.size() - 2] = '}';
+    BOOST_CHECK(!JSONX::Value::parse(s5).valid());
+    BOOST_CHECK(!JSONX::Value::parse(s5, &pc).valid());
+
+    // The depth limit counts from the root, as in the serial parser
+    for (size_t depth = 1; depth <= 5; ++depth)
+    {
+        JSONX::ParseConfig serial;
+        serial.setMaxDepth(depth);
+        JSONX::ParseConfig parallel(serial);
+        parallel.setThreads(4);
+        const JSONX::Value& expectedVal = JSONX::Value::parse(s, &serial);
+        const JSONX::Value& parsed = JSONX::Value::parse(s, &parallel);
+        BOOST_CHECK_EQUAL(parsed.valid(), expectedVal.valid());
+        std::string s6(s);
+        const JSONX::Value& inSitu = JSONX::Value::parseInSitu(std::move(s6), &parallel);
+        BOOST_CHECK_EQUAL(inSitu.valid(), expectedVal.valid());
+        if (expectedVal.valid())
+        {
+            BOOST_CHECK(parsed.serialize() == expected);
+            BOOST_CHECK(inSitu.serialize() == expected);
+        }
+    }
+
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    // A worker running out of memory throws on the calling thread
+    LimitedResource limited(1048576);
+    JSONX::ParseConfig lpc(pc);
+    lpc.setMemoryResource(&limited);
+    BOOST_CHECK_THROW(JSONX::Value::parse(s, &lpc), std::bad_alloc);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(CheckLazyParse)
+{
+    JSONX::ParseConfig pc;
+    pc.setLazy(true);
+
+    JSONX::Value val;
+    {
+        // The document keeps its own copy of the input
+        const std::string s(json1);
+        val = JSONX::Value::parse(s, &pc);
+    }
+    BOOST_CHECK(val.isObject());
+    BOOST_CHECK_EQUAL(val["ticket"]["issuer"].getString(), "Xiang Ye");
+    BOOST_CHECK_EQUAL(val["ticket"]["rights"].size(), 3);
+
+    // Only the path which is accessed is read
+    const std::string s(json1);
+    JSONX::IMPLEMENT::Parser parser(s.data(), s.size());
+    parser.setLazy(std::shared_ptr<void>());
+    std::unique_ptr<JSONX::IMPLEMENT::ValueBase> sp(parser.readValue());
+    const JSONX::IMPLEMENT::ValueObject* root = dynamic_cast<const JSONX::IMPLEMENT::ValueObject*>(sp.get());
+    BOOST_REQUIRE(root != nullptr);
+    BOOST_CHECK(!root->isLoaded());
+    const JSONX::IMPLEMENT::ValueObject* ticket = dynamic_cast<const JSONX::IMPLEMENT::ValueObject*>(root->get("ticket").get());
+    BOOST_CHECK(root->isLoaded());
+    BOOST_REQUIRE(ticket != nullptr);
+    BOOST_CHECK(!ticket->isLoaded());
+    BOOST_CHECK(!dynamic_cast<const JSONX::IMPLEMENT::ValueObject*>(root->get("user").get())->isLoaded());
+    const JSONX::IMPLEMENT::ValueArray* rights = dynamic_cast<const JSONX::IMPLEMENT::ValueArray*>(ticket->get("rights").get());
+    BOOST_REQUIRE(rights != nullptr);
+    BOOST_CHECK(!rights->isLoaded());
+    BOOST_CHECK_EQUAL(rights->size(), 3);
+    BOOST_CHECK(rights->isLoaded());
+
+    checkJson1(val);
+    BOOST_CHECK_EQUAL(val.serialize(), JSONX::Value::parse(json1).serialize());
+
+    // The whole input is still validated
+    BOOST_CHECK(!JSONX::Value::parse(std::string("{\"a\":[1,{\"b\":tru}]}"), &pc).valid());
+
+    // Members can still be changed
+    JSONX::Value val2 = JSONX::Value::parse(std::string("[{\"a\":1},[2]]"), &pc);
+    val2.push_back(3);
+    BOOST_CHECK_EQUAL(val2.serialize(), "[{\"a\":1},[2],3]");
+
+    // Nested containers are read with the same settings
+    const std::string dup("{\"o\":{\"a\":1,\"a\":2},\"n\":[0.10000000000000000001]}");
+    pc.setDuplicateKeys(JSONX::DuplicateFirstWins);
+    pc.setRawNumbers(true);
+    const JSONX::Value& val3 = JSONX::Value::parse(dup, &pc);
+    BOOST_CHECK_EQUAL(val3["o"]["a"].getInt32(), 1);
+    BOOST_CHECK_EQUAL(val3["n"].serialize(), "[0.10000000000000000001]");
+    pc.setDuplicateKeys(JSONX::DuplicateError);
+    BOOST_CHECK(!JSONX::Value::parse(dup, &pc).valid());
+    pc.setDuplicateKeys(JSONX::DuplicateLastWins);
+    pc.setRawNumbers(false);
+
+    // Const reads from several threads
+    const JSONX::Value& shared = JSONX::Value::parse(std::string(json1), &pc);
+    std::vector<std::thread> readers;
+    std::atomic<int> matches(0);
+    for (int i = 0; i < 4; ++i)
+    {
+        readers.push_back(std::thread([&]() {
+            if (shared["ticket"]["issuer"].getString() == "Xiang Ye" && shared["ticket"]["rights"].size() == 3)
+                ++matches;
+        }));
+    }
+    for (size_t i = 0; i < readers.size(); ++i)
+        readers[i].join();
+    BOOST_CHECK_EQUAL(matches.load(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(CheckTapeDocument)
+{
+    JSONX::TapeDocument doc;
+    BOOST_REQUIRE(doc.parse(json1));
+    const JSONX::TapeValue root = doc.root();
+    BOOST_CHECK(root.isObject());
+    BOOST_CHECK_EQUAL(root["ticket"]["issuer"].getString(), "Xiang Ye");
+    BOOST_CHECK_EQUAL(root["ticket"]["rights"].size(), 3);
+    BOOST_CHECK(!root["nothing"].valid());
+    BOOST_CHECK(!root["ticket"]["rights"][3].valid());
+    BOOST_CHECK_EQUAL(root.serialize(), JSONX::Value::parse(json1).serialize());
+
+    // Scalars
+    BOOST_REQUIRE(doc.parse(std::string("[null,true,false,-7,18446744073709551615,1.5,\"a\\\"b\",{},[]]")));
+    const JSONX::TapeValue arr = doc.root();
+    BOOST_CHECK_EQUAL(arr.size(), 9);
+    BOOST_CHECK(arr[0].isNull());
+    BOOST_CHECK(arr[1].isBoolean() && arr[1].getBoolean());
+    BOOST_CHECK(arr[2].isBoolean() && !arr[2].getBoolean());
+    BOOST_CHECK(arr[3].isSignedNumber() && arr[3].getInt64() == -7);
+    BOOST_CHECK(arr[4].isIntegerNumber() && arr[4].getUint64() == 18446744073709551615ULL);
+    BOOST_CHECK(arr[5].isDecimalNumber() && arr[5].getDecimal() == 1.5);
+    BOOST_CHECK_EQUAL(arr[6].getString(), "a\"b");
+    BOOST_CHECK(arr[7].isObject() && arr[7].size() == 0);
+    BOOST_CHECK(arr[8].isArray() && arr[8].size() == 0);
+    BOOST_CHECK_EQUAL(arr.serialize(), "[null,true,false,-7,18446744073709551615,1.5,\"a\\\"b\",{},[]]");
+
+    size_t members = 0;
+    doc.parse(std::string("{\"a\":1,\"b\":[2,3],\"c\":{\"d\":4}}"));
+    doc.root().forEachMember([&](const char* key, size_t n, const JSONX::TapeValue& v) {
+        BOOST_CHECK_EQUAL(n, 1);
+        BOOST_CHECK(*key == 'a' + static_cast<char>(members));
+        BOOST_CHECK(v.valid());
+        ++members;
+    });
+    BOOST_CHECK_EQUAL(members, 3);
+    BOOST_CHECK_EQUAL(doc.root()["c"]["D"].getInt32(), 4);
+
+    // Errors leave an empty document
+    BOOST_CHECK(!doc.parse(std::string("{\"a\":[1,tru]}")));
+    BOOST_CHECK(!doc.valid());
+    BOOST_CHECK(!doc.root().valid());
+    BOOST_CHECK(doc.getError() != JSONX::JESuccess);
+}
+
+BOOST_AUTO_TEST_CASE(CheckProjection)
+{
+    const JSONX::Value& val = JSONX::Value::parse(std::string(json1), { "/user/id", "ticket.rights", "/repositories/*/name" });
+    BOOST_REQUIRE(val.isObject());
+    BOOST_CHECK_EQUAL(val.size(), 3);
+    BOOST_CHECK_EQUAL(val["user"].size(), 1);
+    BOOST_CHECK_EQUAL(val["user"]["id"].getInt32(), 18921);
+    BOOST_CHECK_EQUAL(val["ticket"].serialize(), "{\"rights\":[\"query\",\"read\",\"write\"]}");
+    BOOST_CHECK_EQUAL(val["repositories"].size(), 3);
+    BOOST_CHECK_EQUAL(val["repositories"][1].serialize(), "{\"name\":\"Private Storage 1\"}");
+
+    // Indexes, and a named member next to "*"
+    const std::string s("{\"a\":[{\"x\":1,\"y\":2},{\"x\":3,\"y\":4}],\"b~/c\":{\"x\":5,\"y\":6},\"d\":{\"x\":7,\"y\":8}}");
+    BOOST_CHECK_EQUAL(JSONX::Value::parse(s, { "/a/1/y" }).serialize(), "{\"a\":[{\"y\":4}]}");
+    BOOST_CHECK_EQUAL(JSONX::Value::parse(s, { "/*/x", "/d/y" }).serialize(), "{\"a\":[],\"b~\\/c\":{\"x\":5},\"d\":{\"x\":7,\"y\":8}}");
+    BOOST_CHECK_EQUAL(JSONX::Value::parse(s, { "/b~0~1c" }).serialize(), "{\"b~\\/c\":{\"x\":5,\"y\":6}}");
+    BOOST_CHECK_EQUAL(JSONX::Value::parse(s, { "" }).serialize(), JSONX::Value::parse(s).serialize());
+    BOOST_CHECK_EQUAL(JSONX::Value::parse(s, { "/none" }).serialize(), "{}");
+
+    // Skipped values are still validated
+    BOOST_CHECK(!JSONX::Value::parse(std::string("{\"a\":1,\"b\":[tru]}"), { "/a" }).valid());
+
+    // Same with the structural index
+    JSONX::ParseConfig pc;
+    pc.setStructuralIndex(true);
+    BOOST_CHECK_EQUAL(JSONX::Value::parse(s, { "/d/x" }, &pc).serialize(), "{\"d\":{\"x\":7}}");
+
+    // In situ, the selected keys refer to the decoded buffer
+    std::string s2("{\"k\\u00e9y\":{\"x\":1,\"y\":2},\"z\":3}");
+    JSONX::Projection projection({ "/k\xC3\xA9y/y" });
+    JSONX::IMPLEMENT::InSituParser parser(&s2[0], s2.size());
+    std::unique_ptr<JSONX::IMPLEMENT::ValueBase> sp(parser.readValue(projection.getRoot()));
+    BOOST_REQUIRE(sp != nullptr);
+    BOOST_CHECK_EQUAL(sp->serialize(nullptr), "{\"k\xC3\xA9y\":{\"y\":2}}");
+}
+
+BOOST_AUTO_TEST_CASE(CheckSkipAndValidate)
+{
+    // Skipped values end where the parser would stop
+    const std::string s("[{\"a\":\"x\\\"]}\\u00e9\",\"b\":[1,-2.5e3,[[]],{}],\"c\":null} , true]");
+    JSONX::IMPLEMENT::Parser parser(s.data(), s.size());
+    BOOST_CHECK_EQUAL(parser.checkValueType(), JSONX::JsonArray);
+    BOOST_CHECK(parser.skipValue());
+    BOOST_CHECK_EQUAL(parser.getPos(), s.size());
+
+    // json1 has trailing commas, which only the parser accepts
+    BOOST_CHECK(!JSONX::validate(json1));
+    BOOST_CHECK(JSONX::validate(JSONX::Value::parse(json1).serialize()));
+    BOOST_CHECK(JSONX::validate(std::string(" {\"a\":[1,2,{\"b\":\"\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\"}]} \n")));
+    BOOST_CHECK(JSONX::validate(std::string("-0.5")));
+    BOOST_CHECK(JSONX::validate(std::string(300, '[') + std::string(300, ']')));
+
+    JSONX::JsonError e = JSONX::JESuccess;
+    BOOST_CHECK(!JSONX::validate(std::string("{\"a\":[1,2}"), &e));
+    BOOST_CHECK_EQUAL(e, JSONX::JEUnexpectedChar);
+    BOOST_CHECK(!JSONX::validate(std::string("{\"a\" 1}"), &e));
+    BOOST_CHECK_EQUAL(e, JSONX::JEMissingColon);
+    BOOST_CHECK(!JSONX::validate(std::string("[\"abc"), &e));
+    BOOST_CHECK_EQUAL(e, JSONX::JEUnexpectedEnd);
+    BOOST_CHECK(!JSONX::validate(std::string("[01]"), &e));
+    BOOST_CHECK(!JSONX::validate(std::string("1e999"), &e));
+    BOOST_CHECK_EQUAL(e, JSONX::JENumberOutOfRange);
+    BOOST_CHECK(!JSONX::validate(std::string("\"\\x\"")));
+    BOOST_CHECK(!JSONX::validate(std::string("\"\\ud800\"")));
+    BOOST_CHECK(!JSONX::validate(std::string("[1] x"), &e));
+    BOOST_CHECK_EQUAL(e, JSONX::JEUnexpectedChar);
+    BOOST_CHECK(!JSONX::validate(std::string(""), &e));
+
+    // Malformed UTF-8: overlong, surrogate, truncated, above U+10FFFF
+    const char* bad[] = { "\"\xC0\xAF\"", "\"\xED\xA0\x80\"", "\"\xE2\x82\"", "\"\xF4\x90\x80\x80\"", "\"0123456789abcdef\xFF\"" };
+    for (const char* b : bad)
+    {
+        BOOST_CHECK(!JSONX::validate(std::string(b), &e));
+        BOOST_CHECK_EQUAL(e, JSONX::JEInvalidUtf8);
+    }
+
+    // Separators and literals are checked strictly
+    const char* malformed[] = { "[1 2]", "[1,,2]", "[,1]", "[1,]", "{,}", "{\"a\":1,}", "{\"a\":1 \"b\":2}", "[[1] [2]]", "[{}{}]", "Null", "True", "[False]" };
+    for (const char* m : malformed)
+    {
+        BOOST_CHECK(!JSONX::validate(std::string(m), &e));
+        BOOST_CHECK_EQUAL(e, JSONX::JEUnexpectedChar);
+    }
+    BOOST_CHECK(JSONX::validate(std::string("[[1],[2],{},{\"a\":[true,false,null]}]")));
+    BOOST_CHECK(JSONX::validate(std::string(" [ ] ")));
+    BOOST_CHECK(JSONX::validate(std::string("{ }")));
+}
+
+BOOST_AUTO_TEST_CASE(CheckParserContext)
+{
+    JSONX::ParseConfig pc;
+    pc.setStructuralIndex(true);
+    JSONX::ParserContext context(&pc);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        const JSONX::Value& val = context.parse(json1);
+        BOOST_CHECK(!context.failed());
+        checkJson1(val);
+
+        // A failure doesn't stick to the next document
+        BOOST_CHECK(!context.parse(std::string("{\"a\":\"b\\q\"}")).valid());
+        BOOST_CHECK(context.failed());
+
+        const JSONX::Value& val2 = context.parse(std::string("[\"x\\ty\", 12, {\"k\": null}]"));
+        BOOST_REQUIRE(val2.isArray());
+        BOOST_CHECK_EQUAL(val2[0].getString(), "x\ty");
+        BOOST_CHECK_EQUAL(val2[1].getInt32(), 12);
+        BOOST_CHECK(val2[2]["k"].isNull());
+    }
+
+    std::string s("{\"a\":\"x\\ny\"}");
+    const JSONX::Value& val3 = context.parseInSitu(&s[0], s.size());
+    BOOST_CHECK_EQUAL(val3["a"].getString(), "x\ny");
+
+    StringCounter counter;
+    BOOST_CHECK_EQUAL(context.parse(json1, strlen(json1), counter), JSONX::JESuccess);
+    BOOST_CHECK_EQUAL(counter.count, 24);
+
+    const std::string strict(JSONX::Value::parse(json1).serialize());
+    BOOST_CHECK(context.validate(strict.data(), strict.size()));
+    BOOST_CHECK(!context.validate("[1,", 3));
+    BOOST_CHECK_EQUAL(context.getError(), JSONX::JEUnexpectedEnd);
+}
+
+BOOST_AUTO_TEST_CASE(CheckMaxDepth)
+{
+    const std::string deep = std::string(2000, '[') + std::string(2000, ']');
+    const std::string ok = std::string(1024, '[') + std::string(1024, ']');
+
+    // Default limit
+    JSONX::IMPLEMENT::Parser parser(deep.data(), deep.size());
+    BOOST_CHECK(parser.readValue() == nullptr);
+    BOOST_CHECK_EQUAL(parser.getError(), JSONX::JEMaxDepthExceeded);
+    BOOST_CHECK(JSONX::Value::parse(ok).valid());
+    BOOST_CHECK(!JSONX::Value::parse(ok.substr(0, 1024) + "{\"a\":1}" + ok.substr(1024)).valid());
+
+    JSONX::BaseHandler handler;
+    BOOST_CHECK_EQUAL(JSONX::parse(deep, handler), JSONX::JEMaxDepthExceeded);
+    BOOST_CHECK_EQUAL(JSONX::parse(ok, handler), JSONX::JESuccess);
+    JSONX::JsonError e = JSONX::JESuccess;
+    BOOST_CHECK(!JSONX::validate(deep, &e));
+    BOOST_CHECK_EQUAL(e, JSONX::JEMaxDepthExceeded);
+
+    // Configured
+    JSONX::ParseConfig pc;
+    pc.setMaxDepth(3);
+    BOOST_CHECK(JSONX::Value::parse(std::string("{\"a\":[{\"b\":1}]}"), &pc).valid());
+    BOOST_CHECK(!JSONX::Value::parse(std::string("{\"a\":[{\"b\":[]}]}"), &pc).valid());
+    JSONX::JsonReader reader("[[[[1]]]]", 9, &pc);
+    while (reader.next())
+        ;
+    BOOST_CHECK_EQUAL(reader.getError(), JSONX::JEMaxDepthExceeded);
+    JSONX::PushParser push(&pc);
+    BOOST_CHECK_EQUAL(push.feed("[[[[1]]]]", 9), JSONX::FeedError);
+    BOOST_CHECK_EQUAL(push.getError(), JSONX::JEMaxDepthExceeded);
+
+    // No limit: nothing is recursive while parsing
+    pc.setMaxDepth(0);
+    const std::string deeper = std::string(100000, '[') + std::string(100000, ']');
+    BOOST_CHECK_EQUAL(JSONX::parse(deeper, handler, &pc), JSONX::JESuccess);
+    BOOST_CHECK(JSONX::Value::parse(deep, &pc).valid());
+
+    // The iterative loop reads what the parser read before
+    const JSONX::Value& val = JSONX::Value::parse(std::string("{\"a\":[1,{\"b\":[[],{}]},\"x\"],\"c\":{}}"));
+    BOOST_CHECK_EQUAL(val.serialize(), "{\"a\":[1,{\"b\":[[],{}]},\"x\"],\"c\":{}}");
+    BOOST_CHECK(!JSONX::Value::parse(std::string("{\"a\":[1,{\"b\":[[],{}]},\"x\"],\"c\":{}")).valid());
+}
+
+BOOST_AUTO_TEST_CASE(CheckDuplicateKeys)
+{
+    const std::string s("{\"a\":1,\"b\":2,\"A\":3,\"c\":4,\"b\":5}");
+    BOOST_CHECK_EQUAL(JSONX::Value::parse(s).serialize(), "{\"a\":3,\"b\":5,\"c\":4}");
+
+    JSONX::ParseConfig pc;
+    pc.setDuplicateKeys(JSONX::DuplicateFirstWins);
+    BOOST_CHECK_EQUAL(JSONX::Value::parse(s, &pc).serialize(), "{\"a\":1,\"b\":2,\"c\":4}");
+    pc.setDuplicateKeys(JSONX::DuplicateError);
+    BOOST_CHECK(!JSONX::Value::parse(s, &pc).valid());
+    JSONX::IMPLEMENT::Parser parser(s.data(), s.size(), &pc);
+    BOOST_CHECK(parser.readValue() == nullptr);
+    BOOST_CHECK_EQUAL(parser.getError(), JSONX::JEDuplicateKey);
+    JSONX::PushParser push(&pc);
+    BOOST_CHECK_EQUAL(push.feed(s.data(), s.size()), JSONX::FeedError);
+    BOOST_CHECK_EQUAL(push.getError(), JSONX::JEDuplicateKey);
+
+    // Large objects are sorted instead of compared pairwise
+    std::string big("{");
+    for (int i = 0; i < 50000; ++i)
+        big += "\"k" + std::to_string(i) + "\":" + std::to_string(i) + ",";
+    big += "\"K7\":-1,\"k49999\":-2}";
+    pc.setDuplicateKeys(JSONX::DuplicateLastWins);
+    const JSONX::Value& val = JSONX::Value::parse(big, &pc);
+    BOOST_REQUIRE(val.isObject());
+    BOOST_CHECK_EQUAL(val.size(), 50000);
+    BOOST_CHECK_EQUAL(val["k7"].getInt32(), -1);
+    BOOST_CHECK_EQUAL(val["k49999"].getInt32(), -2);
+    BOOST_CHECK_EQUAL(val["k8"].getInt32(), 8);
+    pc.setDuplicateKeys(JSONX::DuplicateFirstWins);
+    BOOST_CHECK_EQUAL(JSONX::Value::parse(big, &pc)["k7"].getInt32(), 7);
+    pc.setDuplicateKeys(JSONX::DuplicateError);
+    BOOST_CHECK(!JSONX::Value::parse(big, &pc).valid());
+
+    // Builder of a sorted object
+    std::unique_ptr<JSONX::IMPLEMENT::ValueObject> obj(JSONX::IMPLEMENT::ValueObject::create(false));
+    obj->append("b", std::shared_ptr<JSONX::IMPLEMENT::ValueBase>(JSONX::IMPLEMENT::ValueNumber::create(1)));
+    obj->append("a", std::shared_ptr<JSONX::IMPLEMENT::ValueBase>(JSONX::IMPLEMENT::ValueNumber::create(2)));
+    obj->append("B", std::shared_ptr<JSONX::IMPLEMENT::ValueBase>(JSONX::IMPLEMENT::ValueNumber::create(3)));
+    BOOST_CHECK(!obj->build(JSONX::DuplicateError));
+    BOOST_CHECK_EQUAL(obj->size(), 3);
+    BOOST_CHECK(obj->build());
+    BOOST_CHECK_EQUAL(obj->serialize(nullptr), "{\"a\":2,\"b\":3}");
+}
+
+BOOST_AUTO_TEST_CASE(CheckStringPool)
+{
+    JSONX::StringPool pool;
+    const char* a = pool.intern("key", 3);
+    BOOST_CHECK(a == pool.intern(std::string("key")));
+    BOOST_CHECK(a != pool.intern("kez", 3));
+    BOOST_CHECK_EQUAL(std::string(a), "key");
+    BOOST_CHECK_EQUAL(pool.size(), 2);
+
+    // Keys of all records share the pooled buffers
+    JSONX::ParseConfig pc;
+    pc.setStringPool(&pool, 8);
+    const std::string s("[{\"name\":\"red\",\"id\":1},{\"name\":\"red\",\"id\":2},{\"name\":\"a long value\",\"id\":3}]");
+    const JSONX::Value& val = JSONX::Value::parse(s, &pc);
+    BOOST_REQUIRE(val.isArray());
+    BOOST_CHECK_EQUAL(val.serialize(), JSONX::Value::parse(s).serialize());
+    BOOST_CHECK_EQUAL(val[1]["name"].getString(), "red");
+    // "name", "id" and "red", the long value is not pooled
+    BOOST_CHECK_EQUAL(pool.size(), 5);
+
+    JSONX::IMPLEMENT::Parser parser(s.data(), s.size(), &pc);
+    std::unique_ptr<JSONX::IMPLEMENT::ValueBase> sp(parser.readValue());
+    const JSONX::IMPLEMENT::ValueArray* arr = dynamic_cast<const JSONX::IMPLEMENT::ValueArray*>(sp.get());
+    BOOST_REQUIRE(arr != nullptr);
+    const JSONX::IMPLEMENT::ValueObject* r0 = dynamic_cast<const JSONX::IMPLEMENT::ValueObject*>(arr->begin()->get());
+    const JSONX::IMPLEMENT::ValueObject* r1 = dynamic_cast<const JSONX::IMPLEMENT::ValueObject*>((arr->begin() + 1)->get());
+    BOOST_REQUIRE(r0 != nullptr && r1 != nullptr);
+    BOOST_CHECK(r0->begin()->first.data() == r1->begin()->first.data());
+    BOOST_CHECK(r0->begin()->first.data() == pool.intern("name", 4));
+
+    // Threads share one pool
+    std::vector<std::thread> threads;
+    std::vector<const char*> got(4);
+    for (size_t i = 0; i < got.size(); ++i)
+        threads.push_back(std::thread([&, i]() {
+            for (int k = 0; k < 1000; ++k)
+                pool.intern(std::to_string(k));
+            got[i] = pool.intern("shared", 6);
+        }));
+    for (auto& t : threads)
+        t.join();
+    for (size_t i = 1; i < got.size(); ++i)
+        BOOST_CHECK(got[i] == got[0]);
+    BOOST_CHECK_EQUAL(pool.size(), 1006);
+}
+
+BOOST_AUTO_TEST_CASE(CheckColumnarArray)
+{
+    JSONX::ParseConfig pc;
+    pc.setColumnar(true);
+    const std::string s("{\"rows\":[{\"id\":1,\"price\":2.5,\"ok\":true,\"name\":\"a\"},{\"id\":-2,\"price\":3.0,\"ok\":false,\"name\":\"b\\nc\"},{\"id\":3,\"price\":0.25,\"ok\":true,\"name\":\"\"}]}");
+    const JSONX::Value& val = JSONX::Value::parse(s, &pc);
+    BOOST_REQUIRE(val.isObject());
+    BOOST_CHECK_EQUAL(val.serialize(), JSONX::Value::parse(s).serialize());
+
+    const JSONX::Value& rows = val["rows"];
+    const JSONX::IMPLEMENT::ColumnTable* table = rows.getColumns();
+    BOOST_REQUIRE(table != nullptr);
+    BOOST_CHECK_EQUAL(table->rows(), 3);
+    BOOST_CHECK_EQUAL(table->columns(), 4);
+    BOOST_CHECK_EQUAL(rows.size(), 3);
+    BOOST_CHECK_EQUAL(table->find("PRICE"), 1);
+    BOOST_CHECK_EQUAL(table->find("none"), 4);
+    BOOST_CHECK(table->column(0).getType() == JSONX::ColumnInt64);
+    BOOST_CHECK(table->column(1).getType() == JSONX::ColumnDecimal);
+    BOOST_CHECK(table->column(2).getType() == JSONX::ColumnBoolean);
+    BOOST_CHECK(table->column(3).getType() == JSONX::ColumnString);
+    BOOST_CHECK_EQUAL(table->column(0).int64s()[1], -2);
+    BOOST_CHECK_EQUAL(table->column(1).decimals()[2], 0.25);
+    BOOST_CHECK_EQUAL(table->column(2).booleans()[1], 0);
+    const char* str = nullptr;
+    size_t len = 0;
+    table->column(3).getString(1, str, len);
+    BOOST_CHECK_EQUAL(std::string(str, len), "b\nc");
+
+    // Rows are built on access
+    BOOST_CHECK_EQUAL(rows[1]["name"].getString(), "b\nc");
+    BOOST_CHECK_EQUAL(rows[2]["id"].getInt64(), 3);
+    BOOST_CHECK(rows[0]["ok"].getBoolean());
+    BOOST_CHECK(!rows[3].valid());
+
+    // Non-const access converts the array, changes are kept
+    JSONX::Value doc = JSONX::Value::parse(s, &pc);
+    JSONX::Value arr = doc["rows"];
+    BOOST_REQUIRE(arr.getColumns() != nullptr);
+    arr[0].set("id", 10);
+    BOOST_CHECK(arr.getColumns() == nullptr);
+    BOOST_CHECK_EQUAL(arr[0]["id"].getInt64(), 10);
+    BOOST_CHECK_EQUAL(arr.size(), 3);
+
+    // Const iteration keeps the columns, also from several threads
+    const std::string list("[{\"id\":0},{\"id\":1},{\"id\":2},{\"id\":3},4]");
+    JSONX::IMPLEMENT::Parser parser(list.data(), list.size(), &pc);
+    std::unique_ptr<JSONX::IMPLEMENT::ValueBase> sp(parser.readValue());
+    const JSONX::IMPLEMENT::ValueArray* pArray = dynamic_cast<const JSONX::IMPLEMENT::ValueArray*>(sp.get());
+    BOOST_REQUIRE(pArray != nullptr);
+    std::vector<std::thread> readers;
+    std::atomic<int> matches(0);
+    for (int i = 0; i < 4; ++i)
+    {
+        readers.push_back(std::thread([&]() {
+            size_t objects = 0;
+            for (auto it = pArray->begin(); it != pArray->end(); ++it)
+                objects += (*it)->isObject() ? 1 : 0;
+            if (4 == objects && 5 == pArray->end() - pArray->begin())
+                ++matches;
+        }));
+    }
+    for (size_t i = 0; i < readers.size(); ++i)
+        readers[i].join();
+    BOOST_CHECK_EQUAL(matches.load(), 4);
+    BOOST_REQUIRE(pArray->getColumns() != nullptr);
+    BOOST_CHECK_EQUAL(pArray->getColumns()->rows(), 4);
+
+    // Elements after a row which doesn't fit stay objects
+    const std::string mixed("[{\"a\":1,\"b\":\"x\"},{\"a\":2,\"b\":\"y\"},{\"a\":\"3\",\"b\":\"z\"},{\"a\":4,\"b\":\"w\"},5]");
+    const JSONX::Value& m = JSONX::Value::parse(mixed, &pc);
+    BOOST_REQUIRE(m.getColumns() != nullptr);
+    BOOST_CHECK_EQUAL(m.getColumns()->rows(), 2);
+    BOOST_CHECK_EQUAL(m.size(), 5);
+    BOOST_CHECK_EQUAL(m.serialize(), JSONX::Value::parse(mixed).serialize());
+    BOOST_CHECK_EQUAL(m[2]["a"].getString(), "3");
+    BOOST_CHECK_EQUAL(m[4].getInt64(), 5);
+
+    // No columns for nested values, nulls or a first element which isn't an object
+    BOOST_CHECK(JSONX::Value::parse("[{\"a\":[1]},{\"a\":[2]}]", &pc).getColumns() == nullptr);
+    BOOST_CHECK(JSONX::Value::parse("[{\"a\":null},{\"a\":null}]", &pc).getColumns() == nullptr);
+    BOOST_CHECK(JSONX::Value::parse("[1,{\"a\":1},{\"a\":2}]", &pc).getColumns() == nullptr);
+    BOOST_CHECK(JSONX::Value::parse("[{\"a\":1},{\"a\":2}]").getColumns() == nullptr);
+}
+
+struct BoundItem
+{
+    std::string name;
+    double price;
+    std::vector<int32_t> counts;
+};
+JSONX_DEFINE(BoundItem, name, price, counts)
+
+struct BoundOrder
+{
+    uint64_t id;
+    bool paid;
+    std::wstring note;
+    std::vector<BoundItem> items;
+    JSONX::Value extra;
+};
+JSONX_DEFINE(BoundOrder, id, paid, note, items, extra)
+
+struct BoundTree
+{
+    int32_t v;
+    std::vector<BoundTree> children;
+};
+JSONX_DEFINE(BoundTree, v, children)
+
+BOOST_AUTO_TEST_CASE(CheckStructBinding)
+{
+    const std::string s("{\"ID\":18446744073709551615,\"paid\":true,\"unknown\":{\"a\":[1,2]},\"note\":\"caf\\u00e9\","
+        "\"items\":[{\"name\":\"pen\",\"price\":1.5,\"counts\":[1,2,3]},{\"name\":\"ink\",\"price\":2,\"counts\":null}],\"extra\":{\"k\":\"v\"}}");
+    BoundOrder order;
+    order.id = 0;
+    order.paid = false;
+    BOOST_CHECK_EQUAL(JSONX::parseInto(s, order), JSONX::JESuccess);
+    BOOST_CHECK_EQUAL(order.id, 18446744073709551615ULL);
+    BOOST_CHECK(order.paid);
+    BOOST_CHECK(order.note == L"café");
+    BOOST_REQUIRE_EQUAL(order.items.size(), 2);
+    BOOST_CHECK_EQUAL(order.items[0].name, "pen");
+    BOOST_CHECK_EQUAL(order.items[0].price, 1.5);
+    BOOST_CHECK_EQUAL(order.items[0].counts.size(), 3);
+    BOOST_CHECK_EQUAL(order.items[0].counts[2], 3);
+    BOOST_CHECK_EQUAL(order.items[1].price, 2.0);
+    BOOST_CHECK(order.items[1].counts.empty());
+    BOOST_CHECK_EQUAL(order.extra["k"].getString(), "v");
+
+    // Missing members keep the value, type and range errors stop the parser
+    BoundItem item;
+    item.name = "keep";
+    item.price = 0;
+    BOOST_CHECK_EQUAL(JSONX::parseInto("{\"price\":-3e2}", item), JSONX::JESuccess);
+    BOOST_CHECK_EQUAL(item.name, "keep");
+    BOOST_CHECK_EQUAL(item.price, -300.0);
+    BOOST_CHECK_EQUAL(JSONX::parseInto("{\"name\":1}", item), JSONX::JEMismatchValueType);
+    BOOST_CHECK_EQUAL(JSONX::parseInto("{\"counts\":[2147483648]}", item), JSONX::JEMismatchValueType);
+    BOOST_CHECK_EQUAL(JSONX::parseInto("{\"counts\":[1.5]}", item), JSONX::JEMismatchValueType);
+    BOOST_CHECK_EQUAL(JSONX::parseInto("{\"name\":\"a\"} x", item), JSONX::JEUnexpectedChar);
+    BOOST_CHECK_EQUAL(JSONX::parseInto("{\"name\":\"a\"", item), JSONX::JEUnexpectedEnd);
+
+    // Plain types and nested containers
+    std::vector<std::vector<int64_t>> matrix;
+    BOOST_CHECK_EQUAL(JSONX::parseInto("[[1,-2],[],[3]]", matrix), JSONX::JESuccess);
+    BOOST_REQUIRE_EQUAL(matrix.size(), 3);
+    BOOST_CHECK_EQUAL(matrix[0][1], -2);
+    BOOST_CHECK(matrix[1].empty());
+    std::vector<bool> flags;
+    BOOST_CHECK_EQUAL(JSONX::parseInto("[true,false,true]", flags), JSONX::JESuccess);
+    BOOST_CHECK_EQUAL(flags.size(), 3);
+    BOOST_CHECK(!flags[1]);
+
+    // Recursive types are limited by the maximum depth
+    BoundTree tree;
+    BOOST_CHECK_EQUAL(JSONX::parseInto("{\"v\":1,\"children\":[{\"v\":2,\"children\":[{\"v\":3}]}]}", tree), JSONX::JESuccess);
+    BOOST_CHECK_EQUAL(tree.children[0].children[0].v, 3);
+    JSONX::ParseConfig pc;
+    pc.setMaxDepth(3);
+    BOOST_CHECK_EQUAL(JSONX::parseInto("{\"children\":[{\"children\":[{}]}]}", tree, &pc), JSONX::JEMaxDepthExceeded);
+
+#ifdef JSONX_HAS_OPTIONAL
+    std::optional<std::vector<std::optional<int32_t>>> opt;
+    BOOST_CHECK_EQUAL(JSONX::parseInto("[1,null]", opt), JSONX::JESuccess);
+    BOOST_REQUIRE(opt.has_value());
+    BOOST_CHECK(opt->at(0).has_value() && !opt->at(1).has_value());
+    BOOST_CHECK_EQUAL(JSONX::parseInto("null", opt), JSONX::JESuccess);
+    BOOST_CHECK(!opt.has_value());
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(CheckStructSerialize)
+{
+    BoundOrder order;
+    order.id = 7;
+    order.paid = true;
+    order.note = L"a/b \"q\"";
+    BoundItem item;
+    item.name = "pen";
+    item.price = 1.5;
+    item.counts.push_back(-1);
+    item.counts.push_back(2);
+    order.items.push_back(item);
+    item.name = "ink";
+    item.price = 2;
+    item.counts.clear();
+    order.items.push_back(item);
+    order.extra = JSONX::Value::parse("{\"k\":[true,null]}");
+
+    const std::string s = JSONX::serialize(order);
+    BOOST_CHECK_EQUAL(s, "{\"id\":7,\"paid\":true,\"note\":\"a\\/b \\\"q\\\"\",\"items\":[{\"name\":\"pen\",\"price\":1.5,\"counts\":[-1,2]},"
+        "{\"name\":\"ink\",\"price\":2.0,\"counts\":[]}],\"extra\":{\"k\":[true,null]}}");
+
+    // Same output as the DOM, and it reads back
+    JSONX::Value val = JSONX::Value::parse(s);
+    BOOST_CHECK_EQUAL(val.serialize(), s);
+    BoundOrder back;
+    BOOST_CHECK_EQUAL(JSONX::parseInto(s, back), JSONX::JESuccess);
+    BOOST_CHECK_EQUAL(JSONX::serialize(back), s);
+
+    // Into an existing sink, plain types
+    std::string out("x=");
+    JSONX::serialize(std::vector<int64_t>{ INT64_MIN, 0, INT64_MAX }, out);
+    BOOST_CHECK_EQUAL(out, "x=[-9223372036854775808,0,9223372036854775807]");
+    BOOST_CHECK_EQUAL(JSONX::serialize(std::vector<bool>{ true, false }), "[true,false]");
+    BOOST_CHECK_EQUAL(JSONX::serialize(UINT64_MAX), "18446744073709551615");
+    BOOST_CHECK_EQUAL(JSONX::serialize(0.1), "0.1");
+
+#ifdef JSONX_HAS_OPTIONAL
+    std::vector<std::optional<int32_t>> opt{ 1, std::nullopt };
+    BOOST_CHECK_EQUAL(JSONX::serialize(opt), "[1,null]");
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(CheckRawNumbers)
+{
+    JSONX::ParseConfig pc;
+    pc.setRawNumbers(true);
+    const std::string s("{\"big\":123456789012345678901234567890,\"dec\":0.10000000000000000001,\"exp\":-1.5E+3,\"i\":-42,\"u\":18446744073709551615,\"z\":0}");
+    JSONX::Value val = JSONX::Value::parse(s, &pc);
+    BOOST_REQUIRE(val.isObject());
+
+    // Written back exactly as read
+    BOOST_CHECK_EQUAL(val.serialize(), s);
+    BOOST_CHECK_EQUAL(val["big"].serialize(), "123456789012345678901234567890");
+    BOOST_CHECK_EQUAL(val["dec"].serialize(), "0.10000000000000000001");
+
+    // Converted on first access, like a number read normally
+    const JSONX::Value& ref = JSONX::Value::parse(s);
+    BOOST_CHECK(val["i"].isSignedNumber());
+    BOOST_CHECK_EQUAL(val["i"].getInt64(), -42);
+    BOOST_CHECK_EQUAL(val["u"].getUint64(), 18446744073709551615ULL);
+    BOOST_CHECK(val["exp"].isDecimalNumber());
+    BOOST_CHECK_EQUAL(val["exp"].getDecimal(), -1500.0);
+    BOOST_CHECK_EQUAL(val["big"].getDecimal(), ref["big"].getDecimal());
+    BOOST_CHECK_EQUAL(val["dec"].getDecimal(), 0.1);
+    BOOST_CHECK(val["z"].isIntegerNumber());
+    BOOST_CHECK_EQUAL(val.serialize(), s);
+
+    // A new value drops the text
+    val["dec"].set(2.5);
+    BOOST_CHECK_EQUAL(val["dec"].serialize(), "2.5");
+
+    // In situ the text is borrowed from the buffer
+    std::vector<char> buf(s.begin(), s.end());
+    const JSONX::Value& insitu = JSONX::Value::parseInSitu(buf.data(), buf.size(), &pc);
+    BOOST_CHECK_EQUAL(insitu.serialize(), s);
+    BOOST_CHECK_EQUAL(insitu["i"].getInt32(), -42);
+
+    // Invalid numbers still fail
+    BOOST_CHECK(!JSONX::Value::parse("[1.]", &pc).valid());
+    BOOST_CHECK(!JSONX::Value::parse("[01]", &pc).valid());
+    BOOST_CHECK(!JSONX::Value::parse("[1e999]", &pc).valid());
+
+    // Rows with raw numbers are not stored in columns
+    pc.setColumnar(true);
+    const std::string rows("[{\"a\":1.10,\"b\":12345678901234567890123},{\"a\":2.50,\"b\":-0.0}]");
+    const JSONX::Value& table = JSONX::Value::parse(rows, &pc);
+    BOOST_CHECK(table.getColumns() == nullptr);
+    BOOST_CHECK_EQUAL(table.serialize(), rows);
+    BOOST_CHECK_EQUAL(table[1]["a"].getDecimal(), 2.5);
+    BOOST_CHECK(JSONX::Value::parse("[{\"k\":\"x\",\"b\":true},{\"k\":\"y\",\"b\":false}]", &pc).getColumns() != nullptr);
+    pc.setColumnar(false);
+
+    // Pushed numbers split anywhere
+    const std::string pushed("[1.10,12345678901234567890123,{\"e\":-1.5E+3}] 0.10000000000000000001");
+    for (size_t chunk = 1; chunk <= pushed.size(); ++chunk)
+    {
+        JSONX::JsonError error = JSONX::JESuccess;
+        const std::vector<std::string>& docs = feedChunks(pushed, chunk, error, &pc);
+        BOOST_CHECK_EQUAL(error, JSONX::JESuccess);
+        BOOST_REQUIRE_EQUAL(docs.size(), 2);
+        BOOST_CHECK_EQUAL(docs[0], "[1.10,12345678901234567890123,{\"e\":-1.5E+3}]");
+        BOOST_CHECK_EQUAL(docs[1], "0.10000000000000000001");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(CheckArena)
+{
+    JSONX::ParseConfig pc;
+    pc.setArena(true);
+    std::string s("{\"items\":[");
+    for (int i = 0; i < 2000; ++i)
+    {
+        if (i)
+            s.append(",");
+        s.append("{\"id\":" + std::to_string(i) + ",\"name\":\"a rather long item name \\\"" + std::to_string(i) + "\\\"\",\"ok\":true,\"v\":null}");
+    }
+    s.append("]}");
+
+    const std::string& expected = JSONX::Value::parse(s).serialize();
+    JSONX::Value child;
+    {
+        JSONX::Value val = JSONX::Value::parse(s, &pc);
+        BOOST_REQUIRE(val.isObject());
+        BOOST_CHECK_EQUAL(val.serialize(), expected);
+        BOOST_CHECK_EQUAL(val["items"][1999]["name"].getString(), "a rather long item name \"1999\"");
+        child = val["items"][7];
+    }
+    // Nodes keep the arena alive
+    BOOST_CHECK_EQUAL(child["id"].getInt32(), 7);
+    BOOST_CHECK_EQUAL(child["name"].getString(), "a rather long item name \"7\"");
+    child.set("id", 8);
+    BOOST_CHECK_EQUAL(child["id"].getInt32(), 8);
+
+    // Once parsed, two nodes of a document can be changed from two threads
+    JSONX::Value doc = JSONX::Value::parse(s, &pc);
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 2; ++t)
+    {
+        JSONX::Value item = doc["items"][t];
+        writers.push_back(std::thread([item, t]() mutable {
+            JSONX::Value list(JSONX::JsonArray);
+            for (int i = 0; i < 1000; ++i)
+                list.push_back(i);
+            item.set("list", list);
+            item.set("name", std::string("changed by thread ") + std::to_string(t));
+        }));
+    }
+    for (size_t i = 0; i < writers.size(); ++i)
+        writers[i].join();
+    BOOST_CHECK_EQUAL(doc["items"][1]["list"].size(), 1000);
+    BOOST_CHECK_EQUAL(doc["items"][0]["name"].getString(), "changed by thread 0");
+
+    // Failures release what was read
+    BOOST_CHECK(!JSONX::Value::parse("{\"a\":[1,{\"b\":\"some long string value\"},3", &pc).valid());
+    BOOST_CHECK(!JSONX::Value::parse("[1,2,x]", &pc).valid());
+
+    // In situ, with a context, columns and raw numbers
+    std::vector<char> buf(s.begin(), s.end());
+    BOOST_CHECK_EQUAL(JSONX::Value::parseInSitu(buf.data(), buf.size(), &pc).serialize(), expected);
+    JSONX::ParserContext ctx(&pc);
+    for (int k = 0; k < 3; ++k)
+        BOOST_CHECK_EQUAL(ctx.parse(s).serialize(), expected);
+    pc.setColumnar(true);
+    pc.setRawNumbers(true);
+    const JSONX::Value& cols = JSONX::Value::parse("[{\"k\":\"x\",\"n\":true},{\"k\":\"y\",\"n\":false}]", &pc);
+    BOOST_CHECK(cols.getColumns() != nullptr);
+    BOOST_CHECK_EQUAL(cols.serialize(), "[{\"k\":\"x\",\"n\":true},{\"k\":\"y\",\"n\":false}]");
+    const JSONX::Value& numbers = JSONX::Value::parse("[{\"k\":\"x\",\"n\":1.50},{\"k\":\"y\",\"n\":2.25}]", &pc);
+    BOOST_CHECK(numbers.getColumns() == nullptr);
+    BOOST_CHECK_EQUAL(numbers.serialize(), "[{\"k\":\"x\",\"n\":1.50},{\"k\":\"y\",\"n\":2.25}]");
+    JSONX::Value rows = JSONX::Value::parse("[{\"k\":\"x\"},{\"k\":\"y\"}]", &pc);
+    rows[1].set("k", std::string("z"));
+    rows.push_back(true);
+    BOOST_CHECK_EQUAL(rows.serialize(), "[{\"k\":\"x\"},{\"k\":\"z\"},true]");
+    const JSONX::Value& raw = JSONX::Value::parse("[1.50,\"s\"]", &pc);
+    BOOST_CHECK_EQUAL(raw.serialize(), "[1.50,\"s\"]");
+}
+
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+// Counts what goes through it, thread-safe for the parallel parser
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    CountingResource() : allocated(0), outstanding(0) {}
+    size_t allocated;
+    size_t outstanding;
+
+private:
+    void* do_allocate(size_t n, size_t align) override
+    {
+        std::lock_guard<std::mutex> lock(m);
+        allocated += n;
+        outstanding += n;
+        return std::pmr::new_delete_resource()->allocate(n, align);
+    }
+    void do_deallocate(void* p, size_t n, size_t align) override
+    {
+        std::lock_guard<std::mutex> lock(m);
+        outstanding -= n;
+        std::pmr::new_delete_resource()->deallocate(p, n, align);
+    }
+    std::mutex m;
+    bool do_is_equal(const std::pmr::memory_resource& rhs) const noexcept override { return this == &rhs; }
+};
+#endif
+
+BOOST_AUTO_TEST_CASE(CheckMemoryResource)
+{
+#ifdef JSONX_HAS_MEMORY_RESOURCE
+    CountingResource resource;
+    JSONX::ParseConfig pc;
+    pc.setMemoryResource(&resource);
+    BOOST_CHECK(pc.getMemoryResource() == &resource);
+
+    std::string s("[");
+    for (int i = 0; i < 500; ++i)
+        s.append(i ? ",{\"key\":\"a value longer than the small string buffer\",\"n\":1.5}" : "{\"key\":\"a value longer than the small string buffer\",\"n\":1.5}");
+    s.append("]");
+    {
+        const JSONX::Value& val = JSONX::Value::parse(s, &pc);
+        BOOST_REQUIRE(val.isArray());
+        BOOST_CHECK_EQUAL(val.serialize(), JSONX::Value::parse(s).serialize());
+        BOOST_CHECK(resource.allocated > s.size());
+        BOOST_CHECK(resource.outstanding > 0);
+
+        // A second document gets its own arena from the same resource
+        JSONX::ParserContext ctx(&pc);
+        const size_t before = resource.outstanding;
+        JSONX::Value other = ctx.parse("{\"a\":[1,2,3]}");
+        BOOST_CHECK_EQUAL(other["a"][2].getInt32(), 3);
+        BOOST_CHECK(resource.outstanding > before);
+
+        // Changes after the parse come from the resource, not the arena:
+        // what they replace is released at once
+        const size_t allocated = resource.allocated;
+        JSONX::Value doc = JSONX::Value::parse(s, &pc);
+        const size_t parsed = resource.allocated;
+        BOOST_CHECK(parsed > allocated);
+        JSONX::Value item = doc[0];
+        item.set("key", std::string("another value longer than the small string buffer"));
+        const size_t changed = resource.outstanding;
+        for (int i = 0; i < 10000; ++i)
+            item.set("key", std::string("another value longer than the small string buffer"));
+        BOOST_CHECK_EQUAL(resource.outstanding, changed);
+        BOOST_CHECK_EQUAL(item["key"].getString(), "another value longer than the small string buffer");
+        for (int i = 0; i < 10000; ++i)
+            doc.push_back(i);
+        BOOST_CHECK(resource.allocated > parsed);
+        BOOST_CHECK_EQUAL(doc.size(), 10500);
+        BOOST_CHECK_EQUAL(doc[10499].getInt32(), 9999);
+    }
+    // Everything went back once the documents were released
+    BOOST_CHECK_EQUAL(resource.outstanding, 0);
+
+    {
+        // Values built by hand
+        JSONX::Value obj(JSONX::JsonObject, &resource);
+        BOOST_REQUIRE(obj.isObject());
+        const size_t empty = resource.outstanding;
+        BOOST_CHECK(empty > 0);
+        obj.set("s", std::string("a value longer than the small string buffer"));
+        obj.set("n", 1.5);
+        obj.set("b", true);
+        obj.set("w", std::wstring(L"wide"));
+        JSONX::Value arr(JSONX::JsonArray, &resource);
+        for (int i = 0; i < 100; ++i)
+            arr.push_back(i);
+        obj.set("a", arr);
+        BOOST_CHECK(resource.outstanding > empty);
+        BOOST_CHECK_EQUAL(obj.serialize(), "{\"s\":\"a value longer than the small string buffer\",\"n\":1.5,\"b\":true,\"w\":\"wide\",\"a\":[0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40,41,42,43,44,45,46,47,48,49,50,51,52,53,54,55,56,57,58,59,60,61,62,63,64,65,66,67,68,69,70,71,72,73,74,75,76,77,78,79,80,81,82,83,84,85,86,87,88,89,90,91,92,93,94,95,96,97,98,99]}");
+
+        // ValueFactory
+        const size_t before = resource.outstanding;
+        std::shared_ptr<JSONX::IMPLEMENT::ValueString> str = JSONX::IMPLEMENT::ValueFactory::createString(std::string("a value longer than the small string buffer"), false, &resource);
+        BOOST_CHECK_EQUAL(str->get(), "a value longer than the small string buffer");
+        BOOST_CHECK(resource.outstanding > before + sizeof(JSONX::IMPLEMENT::ValueString));
+        str->set(std::string("short"), true);
+        BOOST_CHECK_EQUAL(str->get(), "short");
+        BOOST_CHECK(JSONX::IMPLEMENT::ValueFactory::createNull(&resource)->isNull());
+        BOOST_CHECK(JSONX::IMPLEMENT::ValueFactory::createBoolean(true, &resource)->get());
+        BOOST_CHECK(JSONX::IMPLEMENT::ValueFactory::createObject(false, &resource)->empty());
+        BOOST_CHECK(JSONX::IMPLEMENT::ValueFactory::createArray(&resource)->empty());
+        BOOST_CHECK(JSONX::IMPLEMENT::ValueFactory::create(JSONX::JsonNumber, &resource)->isNumber());
+        BOOST_CHECK(!JSONX::IMPLEMENT::ValueFactory::create(JSONX::JsonUnknown, &resource));
+        str.reset();
+        BOOST_CHECK_EQUAL(resource.outstanding, before);
+    }
+    BOOST_CHECK_EQUAL(resource.outstanding, 0);
+
+    // The other parse paths: each document allocates from the resource, and
+    // releases everything with it
+    std::string big("[");
+    while (big.size() < 2 * 1048576)
+        big.append((big.size() > 1) ? ",{\"key\":\"a value longer than the small string buffer\",\"n\":[1,2]}" : "{\"key\":\"a value longer than the small string buffer\",\"n\":[1,2]}");
+    big.append("]");
+    const std::string& expected = JSONX::Value::parse(big).serialize();
+    std::vector<JSONX::ParseConfig> configs(2, pc);
+    configs[0].setLazy(true);
+    configs[1].setThreads(4);
+    for (size_t i = 0; i < configs.size(); ++i)
+    {
+        {
+            const size_t before = resource.allocated;
+            JSONX::Value doc = JSONX::Value::parse(big, &configs[i]);
+            BOOST_REQUIRE(doc.isArray());
+            BOOST_CHECK_EQUAL(doc.serialize(), expected);
+            BOOST_CHECK(resource.allocated > before + big.size());
+        }
+        BOOST_CHECK_EQUAL(resource.outstanding, 0);
+    }
+
+    {
+        // Lazy containers are read into the resource too
+        JSONX::Value doc = JSONX::Value::parse(s, &configs[0]);
+        const size_t before = resource.allocated;
+        BOOST_CHECK_EQUAL(doc[499]["key"].getString(), "a value longer than the small string buffer");
+        BOOST_CHECK(resource.allocated > before);
+
+        // Projection
+        const size_t projected = resource.allocated;
+        JSONX::Value p = JSONX::Value::parse(s, JSONX::Projection({ "/*/key" }), &pc);
+        BOOST_REQUIRE_EQUAL(p.size(), 500);
+        BOOST_CHECK_EQUAL(p[0]["key"].getString(), "a value longer than the small string buffer");
+        BOOST_CHECK(resource.allocated > projected + 500 * 40);
+
+        // PushParser, fed in small chunks
+        const size_t pushed = resource.allocated;
+        JSONX::PushParser pp(&pc);
+        JSONX::FeedStatus status = JSONX::NeedMoreData;
+        for (size_t i = 0; i < s.size() && JSONX::NeedMoreData == status; i += 7)
+            status = pp.feed(s.data() + i, (std::min)(static_cast<size_t>(7), s.size() - i));
+        BOOST_REQUIRE(JSONX::ValueComplete == status);
+        BOOST_CHECK_EQUAL(pp.value().serialize(), JSONX::Value::parse(s).serialize());
+        BOOST_CHECK(resource.allocated > pushed + s.size());
+    }
+    BOOST_CHECK_EQUAL(resource.outstanding, 0);
+#endif
+}
+
 BOOST_AUTO_TEST_CASE(CheckValueParserCompactedFile)
 {
     const JSONX::Value& val = JSONX::Value::parse(json1);
@@ -430,8 +1868,11 @@ BOOST_AUTO_TEST_CASE(CheckValueParserCompactedFile)
     ofs << s;
     ofs.close();
 
-    const JSONX::Value& val2 = JSONX::Value::parseFile("test.json");
-    checkJson1(val2);
+    {
+        // The mapped file is released with the document
+        const JSONX::Value& val2 = JSONX::Value::parseFile("test.json");
+        checkJson1(val2);
+    }
 #ifndef _DEBUG
     DeleteFileW(L"test.json");
 #endif
@@ -450,12 +1891,53 @@ BOOST_AUTO_TEST_CASE(CheckValueParserFormattedFile)
     ofs << s;
     ofs.close();
 
-    const JSONX::Value& val2 = JSONX::Value::parseFile("test-formatted.json");
-    checkJson1(val2);
-
+    {
+        // The mapped file is released with the document
+        const JSONX::Value& val2 = JSONX::Value::parseFile("test-formatted.json");
+        checkJson1(val2);
+    }
 #ifndef _DEBUG
     DeleteFileW(L"test-formatted.json");
 #endif
 }
 
+BOOST_AUTO_TEST_CASE(CheckValueParserMappedFile)
+{
+    const std::string s("{\"name\":\"a\\\"b\\u00e9\",\"list\":[\"x\",\"y\\ny\"],\"n\":12}");
+
+    std::ofstream ofs;
+    ofs.open(L"test-mapped.json", std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+    BOOST_CHECK(ofs.is_open());
+    ofs << s;
+    ofs.close();
+
+    {
+        JSONX::ParseConfig pc;
+        pc.setPopulate(true);
+        const JSONX::Value& val = JSONX::Value::parseFile("test-mapped.json", &pc);
+        BOOST_CHECK(val.isObject());
+        BOOST_CHECK_EQUAL(val["name"].getString(), "a\"b\xC3\xA9");
+        BOOST_CHECK_EQUAL(val["list"][1].getString(), "y\ny");
+        BOOST_CHECK_EQUAL(val["n"].getInt32(), 12);
+
+        // Decoding in place must not write through to the file
+        std::ifstream ifs("test-mapped.json", std::ifstream::in | std::ifstream::binary);
+        const std::string s2((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+        BOOST_CHECK_EQUAL(s2, s);
+    }
+
+    {
+        JSONX::ParseConfig pc;
+        pc.setFileMapping(false);
+        const JSONX::Value& val = JSONX::Value::parseFile("test-mapped.json", &pc);
+        BOOST_CHECK_EQUAL(val["name"].getString(), "a\"b\xC3\xA9");
+    }
+
+    BOOST_CHECK(!JSONX::Value::parseFile("test-missing.json").valid());
+
+#ifndef _DEBUG
+    DeleteFileW(L"test-mapped.json");
+#endif
+}
+
 BOOST_AUTO_TEST_SUITE_END()